@@ -0,0 +1,42 @@
+#include "AngleMath.hpp"
+
+void fastAtan2(const double* y, const double* x, double* angles, int count) {
+    for (int i = 0; i < count; ++i) {
+        angles[i] = fastAtan2(y[i], x[i]);
+    }
+}
+
+double angleBetween(const Vec2Double& a, const Vec2Double& b) {
+    double cross = a.x * b.y - a.y * b.x;
+    double dot = a.x * b.x + a.y * b.y;
+    return fastAtan2(std::fabs(cross), dot);
+}
+
+Vec2Double unitVector(double angle) {
+    return Vec2Double(std::cos(angle), std::sin(angle));
+}
+
+Vec2Double normalize(const Vec2Double& direction) {
+    double length = std::hypot(direction.x, direction.y);
+    if (length == 0.0) {
+        return Vec2Double(1.0, 0.0);
+    }
+    return Vec2Double(direction.x / length, direction.y / length);
+}
+
+void fanDirections(const Vec2Double& center, double spread, int sideCount, Vec2Double* directions) {
+    Vec2Double* middle = directions + sideCount;
+    *middle = center;
+    if (sideCount == 0) {
+        return;
+    }
+    double step = spread / sideCount;
+    double stepCos = std::cos(step);
+    double stepSin = std::sin(step);
+    for (int i = 1; i <= sideCount; ++i) {
+        const Vec2Double& left = middle[i - 1];
+        const Vec2Double& right = middle[-(i - 1)];
+        middle[i] = Vec2Double(left.x * stepCos - left.y * stepSin, left.x * stepSin + left.y * stepCos);
+        middle[-i] = Vec2Double(right.x * stepCos + right.y * stepSin, right.y * stepCos - right.x * stepSin);
+    }
+}
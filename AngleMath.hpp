@@ -0,0 +1,66 @@
+#ifndef _ANGLEMATH_HPP_
+#define _ANGLEMATH_HPP_
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "model/Vec2Double.hpp"
+
+// Direction math without libm trigonometry in the hot paths. Directions are kept as vectors where the game model
+// allows it, angles are only computed where they are stored (Weapon::lastAngle) or compared with spreads.
+
+namespace angle_math {
+constexpr double PI = 3.14159265358979323846;
+constexpr double SQRT3 = 1.73205080756887729353;
+constexpr double TAN_PI_12 = 0.26794919243112270647;
+}
+
+// atan2 with the absolute error below 1e-13 rad compared to libm. The argument is reduced to [0, tan(pi/12)]
+// where the Taylor series of atan up to the 19th power converges, the code is branch free, so loops over arrays
+// are vectorized by the compiler.
+inline double fastAtan2(double y, double x) {
+    using namespace angle_math;
+    double ax = std::fabs(x);
+    double ay = std::fabs(y);
+    double hi = std::max(ax, ay);
+    double lo = std::min(ax, ay);
+    // Selects instead of branches around the divisions, the loops with branches are not vectorized
+    double t = lo / std::max(hi, std::numeric_limits<double>::min());
+    bool reduced = t > TAN_PI_12;
+    double scale = reduced ? SQRT3 : 1.0;
+    double shift = reduced ? 1.0 : 0.0;
+    double u = (t * scale - shift) / (scale + t * shift);
+    double u2 = u * u;
+    double p = -1.0 / 19;
+    p = p * u2 + 1.0 / 17;
+    p = p * u2 - 1.0 / 15;
+    p = p * u2 + 1.0 / 13;
+    p = p * u2 - 1.0 / 11;
+    p = p * u2 + 1.0 / 9;
+    p = p * u2 - 1.0 / 7;
+    p = p * u2 + 1.0 / 5;
+    p = p * u2 - 1.0 / 3;
+    p = p * u2 + 1.0;
+    double result = p * u + (reduced ? PI / 6 : 0.0);
+    result = ay > ax ? PI / 2 - result : result;
+    // The sign bit rather than x < 0, so -0 gives pi like atan2 does
+    result = std::signbit(x) ? PI - result : result;
+    return std::copysign(result, y);
+}
+
+void fastAtan2(const double* y, const double* x, double* angles, int count);
+
+// Angle between two non zero vectors in [0, pi], exact near 0 and pi unlike acos of the dot product
+double angleBetween(const Vec2Double& a, const Vec2Double& b);
+
+Vec2Double unitVector(double angle);
+
+// Unit vector of the direction, (1, 0) for the zero vector like atan2(0, 0)
+Vec2Double normalize(const Vec2Double& direction);
+
+// Directions of 2 * sideCount + 1 rays spread evenly from -spread to spread around the center direction. Needs one
+// sincos for the step and rotates the center by it, the error stays within a few ulps for the fans of the game.
+void fanDirections(const Vec2Double& center, double spread, int sideCount, Vec2Double* directions);
+
+#endif
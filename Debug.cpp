@@ -1,11 +1,26 @@
 #include "Debug.hpp"
 #include "model/PlayerMessageGame.hpp"
 
+void Debug::BufferStream::writeBytes(const char *buffer, size_t byteCount) {
+  bytes.insert(bytes.end(), buffer, buffer + byteCount);
+}
+
+void Debug::BufferStream::flush() {}
+
 Debug::Debug(const std::shared_ptr<OutputStream> &outputStream)
     : outputStream(outputStream) {}
 
 void Debug::draw(const CustomData &customData) {
-  outputStream->write(PlayerMessageGame::CustomDataMessage::TAG);
-  customData.writeTo(*outputStream);
-  outputStream->flush();
-}
\ No newline at end of file
+  // Units may be planned on several threads at once
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.write(PlayerMessageGame::CustomDataMessage::TAG);
+  customData.writeTo(pending);
+}
+
+void Debug::writePending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!pending.bytes.empty()) {
+    outputStream->writeBytes(pending.bytes.data(), pending.bytes.size());
+    pending.bytes.clear();
+  }
+}
@@ -4,14 +4,37 @@
 #include "Stream.hpp"
 #include "model/CustomData.hpp"
 #include <memory>
+#include <mutex>
+#include <vector>
 
+// Builds with AICUP_DEBUG_DRAW=0 drop the draw calls guarded by Debug::ENABLED
+#ifndef AICUP_DEBUG_DRAW
+#define AICUP_DEBUG_DRAW 1
+#endif
+
+// Drawings are collected during the tick and written in one batch together
+// with the actions of the tick
 class Debug {
 public:
+  static constexpr bool ENABLED = AICUP_DEBUG_DRAW != 0;
+
   Debug(const std::shared_ptr<OutputStream> &outputStream);
   void draw(const CustomData &customData);
+  // Writes the drawings collected since the last call to the output stream
+  // without flushing it
+  void writePending();
 
 private:
+  class BufferStream : public OutputStream {
+  public:
+    void writeBytes(const char *buffer, size_t byteCount) override;
+    void flush() override;
+    std::vector<char> bytes;
+  };
+
   std::shared_ptr<OutputStream> outputStream;
+  BufferStream pending;
+  std::mutex mutex;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,92 @@
+#include "ExposureField.hpp"
+#include <algorithm>
+#include <cmath>
+
+int ExposureField::update(const std::vector<Unit>& enemies, const Game& game, const VisibilityMatrix& visibility,
+                          const std::array<bool, 1200>& reachable) {
+    width = game.level.tiles.size();
+    height = width == 0 ? 0 : game.level.tiles[0].size();
+    exposure.resize(width * height, 0.0);
+
+    for (auto it = contributions.begin(); it != contributions.end();) {
+        bool alive = std::any_of(enemies.begin(), enemies.end(), [&](const Unit& enemy) {
+            return enemy.id == it->first;
+        });
+        if (alive) {
+            ++it;
+        } else {
+            apply(it->second, -1.0);
+            it = contributions.erase(it);
+        }
+    }
+
+    int recomputed = 0;
+    for (const Unit& enemy : enemies) {
+        int muzzleTile = int(enemy.position.y + enemy.size.y / 2) * width + int(enemy.position.x);
+        std::optional<WeaponType> weapon;
+        if (enemy.weapon) {
+            weapon = enemy.weapon->typ;
+        }
+        auto it = contributions.find(enemy.id);
+        if (it != contributions.end() && it->second.muzzleTile == muzzleTile && it->second.weapon == weapon) {
+            continue;
+        }
+        Contribution& contribution = contributions[enemy.id];
+        apply(contribution, -1.0);
+        contribution.muzzleTile = muzzleTile;
+        contribution.weapon = weapon;
+        compute(enemy, game, visibility, reachable, contribution);
+        apply(contribution, 1.0);
+        ++recomputed;
+    }
+    return recomputed;
+}
+
+double ExposureField::getExposure(int tileIndex) const {
+    // Removed contributions may leave a rounding error behind
+    return tileIndex >= 0 && tileIndex < exposure.size() ? std::max(0.0, exposure[tileIndex]) : 0.0;
+}
+
+void ExposureField::apply(const Contribution& contribution, double sign) {
+    for (int i = 0; i < contribution.damage.size(); ++i) {
+        exposure[i] += sign * contribution.damage[i];
+    }
+}
+
+void ExposureField::compute(const Unit& enemy, const Game& game, const VisibilityMatrix& visibility,
+                            const std::array<bool, 1200>& reachable, Contribution& contribution) const {
+    contribution.damage.assign(width * height, 0.0f);
+    if (!enemy.weapon) {
+        return;
+    }
+    const WeaponParams& params = enemy.weapon->params;
+    const Vec2Double& unitSize = game.properties.unitSize;
+    // Half of the unit seen from a random direction, widened by the bullet
+    double bulletReach = (unitSize.x + unitSize.y) / 4 + params.bullet.size / 2;
+    double explosionReach = params.explosion ? bulletReach + params.explosion->radius : 0.0;
+    double muzzleX = enemy.position.x;
+    double muzzleY = enemy.position.y + enemy.size.y / 2;
+    int muzzleTileX = int(muzzleX);
+    int muzzleTileY = int(muzzleY);
+
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y + 1 < height; ++y) {
+            int index = y * width + x;
+            if (index >= reachable.size() || !reachable[index]) {
+                continue;
+            }
+            if (!visibility.isVisible(muzzleTileX, muzzleTileY, x, y) &&
+                !visibility.isVisible(muzzleTileX, muzzleTileY, x, y + 1)) {
+                continue;
+            }
+            double distance = std::max(1e-9, std::hypot(x + 0.5 - muzzleX, y + unitSize.y / 2 - muzzleY));
+            // Share of the aimed spread cone covered by the unit
+            double bulletHit = std::min(1.0, std::atan(bulletReach / distance) / params.minSpread);
+            double damage = bulletHit * params.bullet.damage;
+            if (params.explosion) {
+                damage += std::min(1.0, std::atan(explosionReach / distance) / params.minSpread) * params.explosion->damage;
+            }
+            contribution.damage[index] = damage / params.fireRate;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef _EXPOSUREFIELD_HPP_
+#define _EXPOSUREFIELD_HPP_
+
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "model/Game.hpp"
+#include "VisibilityMatrix.hpp"
+
+// Expected damage per second the enemies deal to a unit standing on a tile, tiles are indexed like the path graph.
+// Every enemy adds the damage rate of its weapon scaled by the chance the aimed bullet hits, to the tiles it can see
+// from its muzzle. The contribution of an enemy is kept between ticks and only recomputed when it moves to another tile
+// or changes the weapon.
+class ExposureField {
+public:
+    // Returns the number of enemies whose contribution was recomputed
+    int update(const std::vector<Unit>& enemies, const Game& game, const VisibilityMatrix& visibility,
+               const std::array<bool, 1200>& reachable);
+
+    double getExposure(int tileIndex) const;
+
+private:
+    struct Contribution {
+        int muzzleTile = -1;
+        std::optional<WeaponType> weapon;
+        std::vector<float> damage;
+    };
+
+    void apply(const Contribution& contribution, double sign);
+    void compute(const Unit& enemy, const Game& game, const VisibilityMatrix& visibility,
+                 const std::array<bool, 1200>& reachable, Contribution& contribution) const;
+
+    int width = 0;
+    int height = 0;
+    std::vector<double> exposure;
+    std::unordered_map<int, Contribution> contributions;
+};
+
+#endif
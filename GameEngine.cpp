@@ -0,0 +1,569 @@
+#include "GameEngine.hpp"
+#include "AngleMath.hpp"
+#include "Simulation.hpp"
+#include "Util.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+// Left halves of the rows of the built-in level from the top, the right halves mirror them
+constexpr std::array<const char*, 30> SIMPLE_LEVEL_HALF = {{
+    "####################",
+    "#...................",
+    "#...................",
+    "#...................",
+    "#...................",
+    "#..........^^^^^^^^^",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#^^^^^^....H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#.....#####H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H...^^^^^",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#...###....H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H........",
+    "#..........H.....##.",
+    "#TP..P.....H.....##.",
+    "####################"
+}};
+
+// Loot of each half of a created game, besides one weapon of every type
+constexpr int HEALTH_PACKS_PER_SIDE = 2;
+constexpr int MINES_PER_SIDE = 1;
+
+constexpr std::array<WeaponType, 3> WEAPON_TYPES = {{PISTOL, ASSAULT_RIFLE, ROCKET_LAUNCHER}};
+
+bool isGround(Tile tile) {
+    return tile == WALL || tile == PLATFORM;
+}
+
+Rect mineRect(const Mine& mine) {
+    return Rect(mine.position.x - mine.size.x / 2, mine.position.y + mine.size.y,
+                mine.position.x + mine.size.x / 2, mine.position.y);
+}
+
+Vec2Double mineCenter(const Mine& mine) {
+    return Vec2Double(mine.position.x, mine.position.y + mine.size.y / 2);
+}
+
+UnitAction standStill() {
+    return UnitAction(0.0, false, false, Vec2Double(0.0, 0.0), false, false, false, false);
+}
+}
+
+Properties GameEngine::defaultProperties() {
+    std::unordered_map<WeaponType, WeaponParams> weaponParams;
+    weaponParams[PISTOL] = WeaponParams(8, 0.4, 1.0, 0.05, 0.5, 0.5, 1.0, BulletParams(50.0, 0.2, 20), nullptr);
+    weaponParams[ASSAULT_RIFLE] = WeaponParams(20, 0.1, 1.0, 0.1, 0.5, 0.2, 1.9, BulletParams(50.0, 0.2, 5), nullptr);
+    weaponParams[ROCKET_LAUNCHER] = WeaponParams(1, 1.0, 1.0, 0.1, 0.5, 1.0, 1.0, BulletParams(20.0, 0.4, 30),
+                                                 std::make_shared<ExplosionParams>(3.0, 50));
+    return Properties(3600, 2, 60.0, 100, Vec2Double(0.5, 0.5), Vec2Double(0.9, 1.8), 10.0, 10.0, 0.55, 10.0, 0.525,
+                      20.0, 100, 50, weaponParams, Vec2Double(0.5, 0.5), ExplosionParams(3.0, 50), 1.0, 0.5, 1.0,
+                      1000);
+}
+
+Level GameEngine::parseLevel(const std::string& text, std::vector<Vec2Double>& spawns) {
+    std::vector<std::string> rows;
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            rows.push_back(line);
+        }
+    }
+    const int width = rows.empty() ? 0 : rows[0].size();
+    const int height = rows.size();
+    if (width != LEVEL_WIDTH || height != LEVEL_HEIGHT) {
+        throw std::runtime_error("The level must be " + std::to_string(LEVEL_WIDTH) + "x" +
+                                 std::to_string(LEVEL_HEIGHT) + " tiles, not " + std::to_string(width) + "x" +
+                                 std::to_string(height));
+    }
+    std::vector<std::vector<Tile>> tiles(width, std::vector<Tile>(height, EMPTY));
+    for (int row = 0; row < height; ++row) {
+        if (int(rows[row].size()) != width) {
+            throw std::runtime_error("The rows of the level differ in length");
+        }
+        const int y = height - 1 - row;
+        for (int x = 0; x < width; ++x) {
+            switch (rows[row][x]) {
+                case '.':
+                    break;
+                case '#':
+                    tiles[x][y] = WALL;
+                    break;
+                case '^':
+                    tiles[x][y] = PLATFORM;
+                    break;
+                case 'H':
+                    tiles[x][y] = LADDER;
+                    break;
+                case 'T':
+                    tiles[x][y] = JUMP_PAD;
+                    break;
+                case 'P':
+                    spawns.emplace_back(x + 0.5, y);
+                    break;
+                default:
+                    throw std::runtime_error(std::string("Unknown tile in the level: ") + rows[row][x]);
+            }
+            bool border = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            if (border && tiles[x][y] != WALL) {
+                // Simulation doesn't check the bounds of the level
+                throw std::runtime_error("The level must be surrounded by walls");
+            }
+        }
+    }
+    return Level(tiles);
+}
+
+std::string GameEngine::simpleLevel() {
+    std::string text;
+    for (const char* half : SIMPLE_LEVEL_HALF) {
+        std::string row = half;
+        row.append(row.rbegin(), row.rend());
+        std::replace(row.begin() + row.size() / 2, row.end(), 'P', '.');
+        text += row + "\n";
+    }
+    return text;
+}
+
+std::string GameEngine::readLevel(const std::string& level) {
+    if (level == "Simple") {
+        return simpleLevel();
+    }
+    std::ifstream file(level);
+    if (!file) {
+        throw std::runtime_error("Failed to open the level " + level);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+Game GameEngine::createGame(const Properties& properties, const std::string& levelText, unsigned seed) {
+    std::vector<Vec2Double> spawns;
+    Level level = parseLevel(levelText, spawns);
+    if (int(spawns.size()) < properties.teamSize) {
+        throw std::runtime_error("The level has fewer spawns than the team size");
+    }
+    const int width = level.tiles.size();
+    const int height = level.tiles[0].size();
+
+    Game game;
+    game.currentTick = 0;
+    game.properties = properties;
+    game.level = level;
+    game.players = {Player(1, 0), Player(2, 0)};
+    for (const Player& player : game.players) {
+        for (int i = 0; i < properties.teamSize; ++i) {
+            Unit unit;
+            unit.playerId = player.id;
+            unit.id = game.units.size() + 1;
+            unit.health = properties.unitMaxHealth;
+            unit.position = spawns[i];
+            if (player.id != game.players[0].id) {
+                unit.position.x = width - unit.position.x;
+            }
+            unit.size = properties.unitSize;
+            unit.jumpState = JumpState(true, properties.unitJumpSpeed, properties.unitJumpTime, true);
+            unit.walkedRight = false;
+            unit.stand = true;
+            unit.onGround = true;
+            unit.onLadder = false;
+            unit.mines = 0;
+            unit.weapon = std::nullopt;
+            game.units.push_back(unit);
+        }
+    }
+
+    // Tiles of the left half a loot box can lie on
+    std::vector<std::pair<int, int>> places;
+    for (int x = 1; x < width / 2; ++x) {
+        for (int y = 1; y + 1 < height; ++y) {
+            bool spawn = std::any_of(spawns.begin(), spawns.end(), [x, y](const Vec2Double& position) {
+                return int(position.x) == x && int(position.y) == y;
+            });
+            if (!spawn && level.tiles[x][y] == EMPTY && level.tiles[x][y + 1] == EMPTY &&
+                isGround(level.tiles[x][y - 1])) {
+                places.emplace_back(x, y);
+            }
+        }
+    }
+    std::mt19937 random(seed);
+    std::shuffle(places.begin(), places.end(), random);
+
+    std::vector<std::shared_ptr<Item>> items;
+    for (WeaponType type : WEAPON_TYPES) {
+        items.push_back(std::make_shared<Item::Weapon>(type));
+    }
+    for (int i = 0; i < HEALTH_PACKS_PER_SIDE; ++i) {
+        items.push_back(std::make_shared<Item::HealthPack>(properties.healthPackHealth));
+    }
+    for (int i = 0; i < MINES_PER_SIDE; ++i) {
+        items.push_back(std::make_shared<Item::Mine>());
+    }
+    for (size_t i = 0; i < items.size() && i < places.size(); ++i) {
+        const auto& [x, y] = places[i];
+        game.lootBoxes.emplace_back(Vec2Double(x + 0.5, y), properties.lootBoxSize, items[i]);
+        game.lootBoxes.emplace_back(Vec2Double(width - x - 0.5, y), properties.lootBoxSize, items[i]);
+    }
+    return game;
+}
+
+std::string GameEngine::formatResults(const std::vector<Player>& players, const std::vector<bool>& crashed,
+                                      unsigned seed) {
+    std::ostringstream json;
+    json << "{\"players\":[";
+    for (size_t i = 0; i < players.size(); ++i) {
+        json << (i > 0 ? "," : "") << "{\"crashed\":" << (crashed[i] ? "true" : "false") << ",\"comment\":null}";
+    }
+    json << "],\"results\":[";
+    for (size_t i = 0; i < players.size(); ++i) {
+        json << (i > 0 ? "," : "") << players[i].score;
+    }
+    json << "],\"seed\":" << seed << "}";
+    return json.str();
+}
+
+GameEngine::GameEngine(Game game, unsigned seed)
+    : game(std::move(game))
+    , random(seed)
+    , debug(std::make_shared<NullOutputStream>()) {
+}
+
+void GameEngine::tick(const std::unordered_map<int, UnitAction>& actions) {
+    std::unordered_map<int, UnitAction> unitActions;
+    for (const Unit& unit : game.units) {
+        auto it = actions.find(unit.id);
+        unitActions[unit.id] = it == actions.end() ? standStill() : it->second;
+    }
+
+    for (Unit& unit : game.units) {
+        const UnitAction& action = unitActions[unit.id];
+        if (unit.weapon) {
+            updateWeapon(unit, action);
+        }
+        if (action.plantMine) {
+            plantMine(unit);
+        }
+    }
+    moveUnits(unitActions);
+    moveBullets();
+    updateMines();
+    for (Unit& unit : game.units) {
+        if (unit.health > 0) {
+            pickUpLoot(unit, unitActions[unit.id]);
+        }
+    }
+    removeDeadUnits();
+    ++game.currentTick;
+}
+
+bool GameEngine::isFinished() const {
+    if (game.currentTick >= game.properties.maxTickCount) {
+        return true;
+    }
+    for (const Player& player : game.players) {
+        bool alive = std::any_of(game.units.begin(), game.units.end(), [&player](const Unit& unit) {
+            return unit.playerId == player.id;
+        });
+        if (!alive) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const Game& GameEngine::getGame() const {
+    return game;
+}
+
+void GameEngine::updateWeapon(Unit& unit, const UnitAction& action) {
+    const double tickTime = 1.0 / game.properties.ticksPerSecond;
+    Weapon& weapon = *unit.weapon;
+    if (weapon.fireTimer) {
+        *weapon.fireTimer -= tickTime;
+        if (*weapon.fireTimer <= 1e-9) {
+            weapon.fireTimer = std::nullopt;
+        }
+    }
+    if (action.reload && weapon.magazine < weapon.params.magazineSize) {
+        weapon.magazine = weapon.params.magazineSize;
+        weapon.fireTimer = weapon.params.reloadTime;
+    }
+    if (action.aim.x != 0.0 || action.aim.y != 0.0) {
+        double aimAngle = fastAtan2(action.aim.y, action.aim.x);
+        if (weapon.lastAngle) {
+            weapon.spread += findAngle(*weapon.lastAngle, aimAngle);
+        }
+        weapon.lastAngle = aimAngle;
+    }
+    weapon.spread = std::clamp(weapon.spread, weapon.params.minSpread, weapon.params.maxSpread);
+    weapon.wasShooting = false;
+    if (action.shoot && !weapon.fireTimer && weapon.lastAngle) {
+        shoot(unit);
+    }
+    weapon.spread = std::clamp(weapon.spread - weapon.params.aimSpeed * tickTime,
+                               weapon.params.minSpread, weapon.params.maxSpread);
+}
+
+void GameEngine::shoot(Unit& unit) {
+    Weapon& weapon = *unit.weapon;
+    std::uniform_real_distribution<double> spread(-weapon.spread, weapon.spread);
+    Vec2Double direction = unitVector(*weapon.lastAngle + spread(random));
+    game.bullets.emplace_back(
+        weapon.typ,
+        unit.id,
+        unit.playerId,
+        Vec2Double(unit.position.x, unit.position.y + unit.size.y / 2),
+        Vec2Double(direction.x * weapon.params.bullet.speed, direction.y * weapon.params.bullet.speed),
+        double(weapon.params.bullet.damage),
+        weapon.params.bullet.size,
+        weapon.params.explosion
+    );
+    if (--weapon.magazine == 0) {
+        weapon.magazine = weapon.params.magazineSize;
+        weapon.fireTimer = weapon.params.reloadTime;
+    } else {
+        weapon.fireTimer = weapon.params.fireRate;
+    }
+    weapon.spread += weapon.params.recoil;
+    weapon.lastFireTick = game.currentTick;
+    weapon.wasShooting = true;
+}
+
+void GameEngine::plantMine(Unit& unit) {
+    const Tile below = game.level.tiles[int(unit.position.x)][int(unit.position.y) - 1];
+    bool standing = unit.jumpState.canJump && areSame(unit.position.y, int(unit.position.y), 0.01) && isGround(below);
+    if (unit.mines == 0 || !standing) {
+        return;
+    }
+    --unit.mines;
+    game.mines.emplace_back(
+        unit.playerId,
+        Vec2Double(unit.position.x, int(unit.position.y)),
+        game.properties.mineSize,
+        PREPARING,
+        std::make_shared<double>(game.properties.minePrepareTime),
+        game.properties.mineTriggerRadius,
+        game.properties.mineExplosionParams
+    );
+}
+
+void GameEngine::moveUnits(const std::unordered_map<int, UnitAction>& actions) {
+    Simulation simulation(game, 0, debug, ColorFloat(1.0, 0.0, 0.0, 0.5), true, false, false,
+                          game.properties.updatesPerTick);
+    simulation.simulate(actions);
+    for (Unit& unit : game.units) {
+        const Unit& moved = simulation.units.at(unit.id);
+        const UnitAction& action = actions.at(unit.id);
+        unit.position = moved.position;
+        unit.jumpState = moved.jumpState;
+        unit.onLadder = checkLadderCollision(unit, game);
+        unit.onGround = unit.jumpState.canJump && unit.jumpState.canCancel &&
+                        areSame(unit.jumpState.maxTime, game.properties.unitJumpTime);
+        unit.stand = action.velocity == 0.0;
+        if (action.velocity != 0.0) {
+            unit.walkedRight = action.velocity > 0.0;
+        }
+    }
+}
+
+void GameEngine::moveBullets() {
+    // Bullets move in microticks against the units at their positions after the tick
+    const int microTicks = game.properties.updatesPerTick;
+    const double microTickTime = 1.0 / (game.properties.ticksPerSecond * microTicks);
+    std::vector<Bullet> flying;
+    for (Bullet bullet : game.bullets) {
+        bool hit = false;
+        for (int i = 0; i < microTicks && !hit; ++i) {
+            bullet.position.x += bullet.velocity.x * microTickTime;
+            bullet.position.y += bullet.velocity.y * microTickTime;
+            hit = collideBullet(bullet);
+        }
+        if (!hit) {
+            flying.push_back(bullet);
+        }
+    }
+    game.bullets = std::move(flying);
+}
+
+bool GameEngine::collideBullet(const Bullet& bullet) {
+    Rect bulletRect(bullet);
+    Unit* hitUnit = nullptr;
+    for (Unit& unit : game.units) {
+        if (unit.id != bullet.unitId && unit.health > 0 && intersectRects(bulletRect, Rect(unit))) {
+            hitUnit = &unit;
+            break;
+        }
+    }
+    Mine* hitMine = nullptr;
+    if (hitUnit == nullptr) {
+        for (Mine& mine : game.mines) {
+            if (mine.state != EXPLODED && intersectRects(bulletRect, mineRect(mine))) {
+                hitMine = &mine;
+                break;
+            }
+        }
+    }
+    if (hitUnit == nullptr && hitMine == nullptr && !checkWallCollision(bulletRect, game)) {
+        return false;
+    }
+    if (hitUnit != nullptr) {
+        damage(*hitUnit, int(bullet.damage), bullet.playerId);
+    }
+    if (bullet.explosionParams) {
+        explode(bullet.position, *bullet.explosionParams, bullet.playerId);
+    }
+    if (hitMine != nullptr && hitMine->state != EXPLODED) {
+        explodeMine(*hitMine);
+    }
+    return true;
+}
+
+void GameEngine::updateMines() {
+    const double tickTime = 1.0 / game.properties.ticksPerSecond;
+    for (Mine& mine : game.mines) {
+        if (mine.state == PREPARING || mine.state == TRIGGERED) {
+            // The timers are shared with the copies of the game given to the strategies, so they're replaced
+            double timer = *mine.timer - tickTime;
+            if (timer > 1e-9) {
+                mine.timer = std::make_shared<double>(timer);
+            } else if (mine.state == PREPARING) {
+                mine.state = IDLE;
+                mine.timer = nullptr;
+            } else {
+                explodeMine(mine);
+            }
+        } else if (mine.state == IDLE) {
+            Vec2Double center = mineCenter(mine);
+            Rect trigger(center.x - mine.triggerRadius, center.y + mine.triggerRadius,
+                         center.x + mine.triggerRadius, center.y - mine.triggerRadius);
+            for (const Unit& unit : game.units) {
+                if (unit.health > 0 && intersectRects(trigger, Rect(unit))) {
+                    mine.state = TRIGGERED;
+                    mine.timer = std::make_shared<double>(game.properties.mineTriggerTime);
+                    break;
+                }
+            }
+        }
+    }
+    game.mines.erase(std::remove_if(game.mines.begin(), game.mines.end(), [](const Mine& mine) {
+        return mine.state == EXPLODED;
+    }), game.mines.end());
+}
+
+void GameEngine::pickUpLoot(Unit& unit, const UnitAction& action) {
+    Rect unitRect(unit);
+    for (size_t i = 0; i < game.lootBoxes.size(); ++i) {
+        LootBox& lootBox = game.lootBoxes[i];
+        if (!intersectRects(unitRect, Rect(lootBox))) {
+            continue;
+        }
+        bool taken = false;
+        if (auto healthPack = std::dynamic_pointer_cast<Item::HealthPack>(lootBox.item)) {
+            if (unit.health < game.properties.unitMaxHealth) {
+                unit.health = std::min(unit.health + healthPack->health, double(game.properties.unitMaxHealth));
+                taken = true;
+            }
+        } else if (auto weaponItem = std::dynamic_pointer_cast<Item::Weapon>(lootBox.item)) {
+            if (!unit.weapon) {
+                unit.weapon = createWeapon(weaponItem->weaponType);
+                taken = true;
+            } else if (action.swapWeapon) {
+                // The old weapon takes the place of the new one, one swap per tick
+                WeaponType dropped = unit.weapon->typ;
+                unit.weapon = createWeapon(weaponItem->weaponType);
+                lootBox.item = std::make_shared<Item::Weapon>(dropped);
+                return;
+            }
+        } else if (std::dynamic_pointer_cast<Item::Mine>(lootBox.item)) {
+            ++unit.mines;
+            taken = true;
+        }
+        if (taken) {
+            game.lootBoxes.erase(game.lootBoxes.begin() + i);
+            --i;
+        }
+    }
+}
+
+void GameEngine::removeDeadUnits() {
+    game.units.erase(std::remove_if(game.units.begin(), game.units.end(), [](const Unit& unit) {
+        return unit.health <= 0;
+    }), game.units.end());
+}
+
+void GameEngine::explode(const Vec2Double& center, const ExplosionParams& params, int playerId) {
+    Rect area(center.x - params.radius, center.y + params.radius, center.x + params.radius, center.y - params.radius);
+    for (Unit& unit : game.units) {
+        if (intersectRects(area, Rect(unit))) {
+            damage(unit, params.damage, playerId);
+        }
+    }
+    for (Mine& mine : game.mines) {
+        if (mine.state != EXPLODED && intersectRects(area, mineRect(mine))) {
+            explodeMine(mine);
+        }
+    }
+}
+
+void GameEngine::explodeMine(Mine& mine) {
+    mine.state = EXPLODED;
+    mine.timer = nullptr;
+    explode(mineCenter(mine), mine.explosionParams, mine.playerId);
+}
+
+void GameEngine::damage(Unit& unit, int amount, int playerId) {
+    if (unit.health <= 0) {
+        return;
+    }
+    double dealt = std::min(double(amount), unit.health);
+    unit.health -= dealt;
+    if (playerId != unit.playerId) {
+        addScore(playerId, int(dealt));
+    }
+    if (unit.health > 0) {
+        return;
+    }
+    // A unit killed by its own team gives the kill to the opponents
+    for (const Player& player : game.players) {
+        if (player.id != unit.playerId && (playerId == unit.playerId || player.id == playerId)) {
+            addScore(player.id, game.properties.killScore);
+        }
+    }
+}
+
+void GameEngine::addScore(int playerId, int score) {
+    for (Player& player : game.players) {
+        if (player.id == playerId) {
+            player.score += score;
+        }
+    }
+}
+
+Weapon GameEngine::createWeapon(WeaponType type) const {
+    const WeaponParams& params = game.properties.weaponParams.at(type);
+    // Picked weapons are reloaded first, the aim starts to the right
+    return Weapon(type, params, params.magazineSize, false, params.maxSpread, params.reloadTime, 0.0, std::nullopt);
+}
@@ -0,0 +1,77 @@
+#ifndef _GAMEENGINE_HPP_
+#define _GAMEENGINE_HPP_
+
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Debug.hpp"
+#include "model/Game.hpp"
+#include "model/UnitAction.hpp"
+
+// Rules of the game around the unit physics of Simulation: weapons and bullets, explosions, mines, loot, health,
+// score and the end of the game. The randomness (loot placement and the bullet spread) comes from the seed only.
+class GameEngine {
+public:
+    // Properties of the config.json preset
+    static Properties defaultProperties();
+
+    // Size of every level of the game, the tables of MyStrategy (paths, reachable tiles) have one entry per tile of it
+    static constexpr int LEVEL_WIDTH = 40;
+    static constexpr int LEVEL_HEIGHT = 30;
+
+    // Level rows from the top: '.' empty, '#' wall, '^' platform, 'H' ladder, 'T' jump pad, 'P' a unit of the first
+    // player on an empty tile. The units of the second player and the loot are mirrored. Throws for a level of
+    // another size than LEVEL_WIDTH x LEVEL_HEIGHT.
+    static Level parseLevel(const std::string& text, std::vector<Vec2Double>& spawns);
+    // Built-in level in the format above
+    static std::string simpleLevel();
+    // Text of the built-in level for "Simple", otherwise of the level file at the path
+    static std::string readLevel(const std::string& level);
+
+    // Two players with properties.teamSize units each and loot placed by the seed
+    static Game createGame(const Properties& properties, const std::string& levelText, unsigned seed);
+
+    // One line of JSON with the object of the LocalRunner's --save-results file, in the order of the players
+    static std::string formatResults(const std::vector<Player>& players, const std::vector<bool>& crashed,
+                                     unsigned seed);
+
+    GameEngine(Game game, unsigned seed);
+
+    GameEngine(const GameEngine&) = delete;
+    GameEngine& operator=(const GameEngine&) = delete;
+
+    // Plays one tick, units without an action stand still
+    void tick(const std::unordered_map<int, UnitAction>& actions);
+
+    // maxTickCount is reached or a player has no units left
+    bool isFinished() const;
+
+    const Game& getGame() const;
+
+private:
+    void updateWeapon(Unit& unit, const UnitAction& action);
+    void shoot(Unit& unit);
+    void plantMine(Unit& unit);
+    void moveUnits(const std::unordered_map<int, UnitAction>& actions);
+    void moveBullets();
+    // Applies the hit of the bullet if it hits something at its position
+    bool collideBullet(const Bullet& bullet);
+    void updateMines();
+    void pickUpLoot(Unit& unit, const UnitAction& action);
+    void removeDeadUnits();
+
+    void explode(const Vec2Double& center, const ExplosionParams& params, int playerId);
+    void explodeMine(Mine& mine);
+    void damage(Unit& unit, int amount, int playerId);
+    void addScore(int playerId, int score);
+
+    Weapon createWeapon(WeaponType type) const;
+
+    Game game;
+    std::mt19937 random;
+    Debug debug;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "GameRecorder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+// Holds the records of a tick, they are written out in one go when the tick ends
+constexpr size_t FILE_BUFFER_SIZE = 1 << 20;
+// uint32 count, uint64 offset and INDEX_MAGIC
+constexpr size_t INDEX_TRAILER_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(GameRecorder::INDEX_MAGIC);
+constexpr size_t INDEX_ENTRY_SIZE = sizeof(int32_t) + sizeof(uint64_t);
+}
+
+GameRecorder::GameRecorder(const std::string& path)
+    : file(std::fopen(path.c_str(), "wb"))
+    , fileBuffer(FILE_BUFFER_SIZE)
+    , offset(0) {
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open the record file " + path);
+    }
+    std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+    writeValue(FILE_MAGIC, sizeof(FILE_MAGIC));
+}
+
+GameRecorder::~GameRecorder() {
+    uint64_t indexOffset = offset;
+    for (const IndexEntry& entry : index) {
+        writeValue(&entry.tick, sizeof(entry.tick));
+        writeValue(&entry.offset, sizeof(entry.offset));
+    }
+    uint32_t count = index.size();
+    writeValue(&count, sizeof(count));
+    writeValue(&indexOffset, sizeof(indexOffset));
+    writeValue(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    if (std::ferror(file) || std::fclose(file) != 0) {
+        std::fprintf(stderr, "Failed to write the record file\n");
+    }
+}
+
+void GameRecorder::recordServerMessage(int tick, const char* data, size_t size) {
+    index.push_back(IndexEntry{tick, offset});
+    writeRecord(SERVER_MESSAGE, tick, data, size);
+}
+
+void GameRecorder::recordPlayerMessages(int tick, const char* data, size_t size) {
+    writeRecord(PLAYER_MESSAGES, tick, data, size);
+    std::fflush(file);
+}
+
+void GameRecorder::writeRecord(RecordKind kind, int tick, const char* data, size_t size) {
+    int32_t recordTick = tick;
+    uint32_t recordSize = size;
+    writeValue(&kind, sizeof(kind));
+    writeValue(&recordTick, sizeof(recordTick));
+    writeValue(&recordSize, sizeof(recordSize));
+    writeValue(data, size);
+}
+
+// The game protocol is little endian, the record file is written in the byte order of the machine as well.
+// Errors are checked once when the file is closed, the game goes on if the disk is full.
+void GameRecorder::writeValue(const void* value, size_t size) {
+    std::fwrite(value, 1, size, file);
+    offset += size;
+}
+
+RecordInputStream::RecordInputStream(const std::string& path)
+    : file(std::fopen(path.c_str(), "rb"))
+    , payloadStart(0)
+    , fileSize(0)
+    , remaining(0)
+    , finished(false)
+    , indexed(false) {
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open the record file " + path);
+    }
+    char magic[sizeof(GameRecorder::FILE_MAGIC)];
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        !std::equal(magic, magic + sizeof(magic), GameRecorder::FILE_MAGIC)) {
+        std::fclose(file);
+        throw std::runtime_error(path + " is not a game record");
+    }
+    payloadStart = std::ftell(file);
+    std::fseek(file, 0, SEEK_END);
+    fileSize = std::ftell(file);
+    readIndex();
+    std::fseek(file, payloadStart, SEEK_SET);
+}
+
+RecordInputStream::~RecordInputStream() {
+    std::fclose(file);
+}
+
+void RecordInputStream::readBytes(char* buffer, size_t byteCount) {
+    while (byteCount > 0) {
+        size_t count = readSome(buffer, byteCount);
+        buffer += count;
+        byteCount -= count;
+    }
+}
+
+size_t RecordInputStream::readSome(char* buffer, size_t maxCount) {
+    if (remaining == 0 && !nextServerMessage()) {
+        if (finished) {
+            throw std::runtime_error("Read after the end of the record");
+        }
+        // The message of the server ending the game
+        finished = true;
+        buffer[0] = 0;
+        return 1;
+    }
+    size_t count = std::fread(buffer, 1, std::min(remaining, maxCount), file);
+    if (count == 0) {
+        throw std::runtime_error("Failed to read the record file");
+    }
+    remaining -= count;
+    return count;
+}
+
+bool RecordInputStream::seekTick(int tick) {
+    uint64_t recordOffset = 0;
+    bool found = false;
+    if (indexed) {
+        auto entry = std::find_if(index.begin(), index.end(), [tick](const GameRecorder::IndexEntry& entry) {
+            return entry.tick == tick;
+        });
+        found = entry != index.end();
+        if (found) {
+            recordOffset = entry->offset;
+        }
+    } else {
+        long position = std::ftell(file);
+        found = scanTick(tick, recordOffset);
+        std::fseek(file, position, SEEK_SET);
+    }
+    if (!found) {
+        return false;
+    }
+    std::fseek(file, recordOffset, SEEK_SET);
+    remaining = 0;
+    finished = false;
+    return true;
+}
+
+void RecordInputStream::readIndex() {
+    if (fileSize < payloadStart + INDEX_TRAILER_SIZE) {
+        return;
+    }
+    uint32_t count;
+    uint64_t indexOffset;
+    char magic[sizeof(GameRecorder::INDEX_MAGIC)];
+    std::fseek(file, fileSize - INDEX_TRAILER_SIZE, SEEK_SET);
+    if (std::fread(&count, sizeof(count), 1, file) != 1 ||
+        std::fread(&indexOffset, sizeof(indexOffset), 1, file) != 1 ||
+        std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        !std::equal(magic, magic + sizeof(magic), GameRecorder::INDEX_MAGIC) ||
+        indexOffset < payloadStart || indexOffset + uint64_t(count) * INDEX_ENTRY_SIZE + INDEX_TRAILER_SIZE != fileSize) {
+        return;
+    }
+    std::fseek(file, indexOffset, SEEK_SET);
+    std::vector<GameRecorder::IndexEntry> entries(count);
+    for (GameRecorder::IndexEntry& entry : entries) {
+        if (std::fread(&entry.tick, sizeof(entry.tick), 1, file) != 1 ||
+            std::fread(&entry.offset, sizeof(entry.offset), 1, file) != 1 ||
+            entry.offset < payloadStart || entry.offset >= indexOffset) {
+            return;
+        }
+    }
+    index = std::move(entries);
+    indexed = true;
+    fileSize = indexOffset;
+}
+
+bool RecordInputStream::scanTick(int tick, uint64_t& recordOffset) {
+    std::fseek(file, payloadStart, SEEK_SET);
+    while (true) {
+        long offset = std::ftell(file);
+        uint8_t kind;
+        int32_t recordTick;
+        uint32_t size;
+        if (std::fread(&kind, sizeof(kind), 1, file) != 1 ||
+            std::fread(&recordTick, sizeof(recordTick), 1, file) != 1 ||
+            std::fread(&size, sizeof(size), 1, file) != 1 ||
+            (kind != GameRecorder::SERVER_MESSAGE && kind != GameRecorder::PLAYER_MESSAGES) ||
+            uint64_t(std::ftell(file)) + size > fileSize) {
+            return false;
+        }
+        if (kind == GameRecorder::SERVER_MESSAGE && recordTick == tick) {
+            recordOffset = offset;
+            return true;
+        }
+        std::fseek(file, size, SEEK_CUR);
+    }
+}
+
+bool RecordInputStream::nextServerMessage() {
+    while (true) {
+        uint8_t kind;
+        int32_t tick;
+        uint32_t size;
+        if (std::fread(&kind, sizeof(kind), 1, file) != 1 ||
+            std::fread(&tick, sizeof(tick), 1, file) != 1 ||
+            std::fread(&size, sizeof(size), 1, file) != 1) {
+            return false;
+        }
+        long payloadOffset = std::ftell(file);
+        if (payloadOffset < 0 || uint64_t(payloadOffset) + size > fileSize) {
+            // The last record of a game cut short
+            return false;
+        }
+        if (kind == GameRecorder::SERVER_MESSAGE && size > 0) {
+            remaining = size;
+            return true;
+        }
+        if (kind != GameRecorder::SERVER_MESSAGE && kind != GameRecorder::PLAYER_MESSAGES) {
+            // The index after the last record
+            return false;
+        }
+        std::fseek(file, size, SEEK_CUR);
+    }
+}
+
+TeeOutputStream::TeeOutputStream(std::shared_ptr<OutputStream> stream) : stream(std::move(stream)) {
+}
+
+void TeeOutputStream::writeBytes(const char* buffer, size_t byteCount) {
+    stream->writeBytes(buffer, byteCount);
+    bytes.insert(bytes.end(), buffer, buffer + byteCount);
+}
+
+void TeeOutputStream::flush() {
+    stream->flush();
+}
+
+const std::vector<char>& TeeOutputStream::getBytes() const {
+    return bytes;
+}
+
+void TeeOutputStream::clearBytes() {
+    bytes.clear();
+}
@@ -0,0 +1,105 @@
+#ifndef _GAMERECORDER_HPP_
+#define _GAMERECORDER_HPP_
+
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Stream.hpp"
+
+// Records the raw messages of a game. The file is a sequence of records
+//     uint8 kind, int32 tick, uint32 size, size bytes
+// after the 8 byte FILE_MAGIC. The index written when the recorder is closed holds the tick and the offset of every
+// server message record, it is followed by the uint32 count of its entries, the uint64 offset of the index and
+// INDEX_MAGIC. The records are flushed at the end of every tick, so a file without the index, e.g. of a crashed game,
+// still has every finished tick and is read record by record.
+class GameRecorder {
+public:
+    enum RecordKind : uint8_t {
+        SERVER_MESSAGE = 0,
+        PLAYER_MESSAGES = 1
+    };
+
+    static constexpr char FILE_MAGIC[8] = {'A', 'I', 'C', 'R', 'E', 'C', '0', '1'};
+    static constexpr char INDEX_MAGIC[8] = {'A', 'I', 'C', 'I', 'D', 'X', '0', '1'};
+
+    struct IndexEntry {
+        int32_t tick;
+        uint64_t offset;
+    };
+
+    explicit GameRecorder(const std::string& path);
+    ~GameRecorder();
+
+    GameRecorder(const GameRecorder&) = delete;
+    GameRecorder& operator=(const GameRecorder&) = delete;
+
+    // Raw ServerMessageGame, the tick is -1 for the message ending the game
+    void recordServerMessage(int tick, const char* data, size_t size);
+    // Everything sent to the server in reply to the message of the tick, ends the tick
+    void recordPlayerMessages(int tick, const char* data, size_t size);
+
+private:
+    void writeRecord(RecordKind kind, int tick, const char* data, size_t size);
+    void writeValue(const void* value, size_t size);
+
+    std::FILE* file;
+    std::vector<char> fileBuffer;
+    uint64_t offset;
+    std::vector<IndexEntry> index;
+};
+
+// Input stream over the server messages of a record file, the recorded replies are skipped. Every readSome returns
+// bytes of one message only, like a socket receiving the messages one by one. A record cut short ends like a finished
+// game.
+class RecordInputStream : public InputStream {
+public:
+    explicit RecordInputStream(const std::string& path);
+    ~RecordInputStream();
+
+    RecordInputStream(const RecordInputStream&) = delete;
+    RecordInputStream& operator=(const RecordInputStream&) = delete;
+
+    void readBytes(char* buffer, size_t byteCount) override;
+    size_t readSome(char* buffer, size_t maxCount) override;
+
+    // Moves to the server message of the tick, to be called between messages. The offset comes from the index, a file
+    // without one is read record by record from the start. False if the tick isn't recorded, nothing moves then.
+    bool seekTick(int tick);
+
+private:
+    // Loads the index if the file ends with a valid one, the records end where it starts
+    void readIndex();
+    // Offset of the server message record of the tick found by reading every record header
+    bool scanTick(int tick, uint64_t& recordOffset);
+    // Moves to the payload of the next server message, false at the end of the records
+    bool nextServerMessage();
+
+    std::FILE* file;
+    uint64_t payloadStart;
+    uint64_t fileSize;
+    size_t remaining;
+    bool finished;
+    bool indexed;
+    std::vector<GameRecorder::IndexEntry> index;
+};
+
+// Output stream passing the bytes through and keeping a copy until it's taken
+class TeeOutputStream : public OutputStream {
+public:
+    explicit TeeOutputStream(std::shared_ptr<OutputStream> stream);
+
+    void writeBytes(const char* buffer, size_t byteCount) override;
+    void flush() override;
+
+    const std::vector<char>& getBytes() const;
+    void clearBytes();
+
+private:
+    std::shared_ptr<OutputStream> stream;
+    std::vector<char> bytes;
+};
+
+#endif
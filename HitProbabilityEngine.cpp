@@ -0,0 +1,181 @@
+#include "HitProbabilityEngine.hpp"
+#include "Util.hpp"
+#include "AngleMath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+Rect bulletRect(const Vec2Double& center, double halfSize) {
+    return Rect(center.x - halfSize, center.y + halfSize, center.x + halfSize, center.y - halfSize);
+}
+
+Rect unitRect(const Vec2Double& position, const Vec2Double& size) {
+    return Rect(position.x - size.x / 2, position.y + size.y, position.x + size.x / 2, position.y);
+}
+
+Vec2Double pointAt(const Vec2Double& origin, const Vec2Double& direction, double distance) {
+    return Vec2Double(origin.x + direction.x * distance, origin.y + direction.y * distance);
+}
+
+// Distances along the ray where it is inside the slab [low, high] of one axis
+bool clipSlab(double origin, double direction, double low, double high, double& enter, double& exit) {
+    if (std::fabs(direction) < 1e-12) {
+        return origin >= low && origin <= high;
+    }
+    double t1 = (low - origin) / direction;
+    double t2 = (high - origin) / direction;
+    if (t1 > t2) {
+        std::swap(t1, t2);
+    }
+    enter = std::max(enter, t1);
+    exit = std::min(exit, t2);
+    return enter <= exit;
+}
+}
+
+HitProbabilityEngine::HitProbabilityEngine(const Game& game, int ticks, const std::optional<VirtualShot>& shot)
+    : game(game)
+    , ticks(ticks)
+    , tickTime(1.0 / game.properties.ticksPerSecond) {
+    if (shot) {
+        std::array<Vec2Double, 2 * HIT_RAYS_PER_SIDE + 1> directions;
+        fanDirections(unitVector(shot->aimAngle), shot->spread, HIT_RAYS_PER_SIDE, directions.data());
+        for (const Vec2Double& direction : directions) {
+            Vec2Double velocity(direction.x * shot->bulletSpeed, direction.y * shot->bulletSpeed);
+            shotRays.push_back(createRay(shot->unitId, shot->playerId, shot->muzzle, velocity, shot->bulletSize,
+                                         shot->shootTime, nullptr));
+        }
+    }
+    for (const Bullet& bullet : game.bullets) {
+        bulletRays.push_back(createRay(bullet.unitId, bullet.playerId, bullet.position, bullet.velocity, bullet.size,
+                                       0.0, &bullet));
+    }
+}
+
+void HitProbabilityEngine::getBulletHits(const std::vector<UnitTrajectory>& units,
+                                         std::array<HitMask, MAX_HIT_UNITS>& hits) const {
+    hits.fill(HitMask());
+    for (int i = 0; i < shotRays.size(); ++i) {
+        const auto& hit = findUnitHit(shotRays[i], units);
+        if (hit && units[hit->unitIdx].playerId != shotRays[i].playerId) {
+            hits[hit->unitIdx].set(i);
+        }
+    }
+}
+
+std::vector<DamageEvent> HitProbabilityEngine::getRealBulletEvents(const std::vector<UnitTrajectory>& units) const {
+    std::vector<DamageEvent> events;
+    for (const Ray& ray : bulletRays) {
+        const Bullet& bullet = *ray.bullet;
+        const auto& hit = findUnitHit(ray, units);
+        if (hit) {
+            events.push_back(DamageEvent{hit->tick + 1, units[hit->unitIdx].unitId, bullet.damage, true, 1.0, 0, 0.0, 0.0});
+            addExplosionEvents(bullet, pointAt(ray.origin, ray.direction, hit->distance), hit->tick, units, events);
+            continue;
+        }
+        int wallTick = int(std::ceil(ray.wallDistance / (ray.speed * tickTime))) - 1;
+        if (wallTick < ticks) {
+            addExplosionEvents(bullet, pointAt(ray.origin, ray.direction, ray.wallDistance), std::max(wallTick, 0), units, events);
+        }
+    }
+    return events;
+}
+
+HitProbabilityEngine::Ray HitProbabilityEngine::createRay(int unitId, int playerId, const Vec2Double& origin,
+                                                          const Vec2Double& velocity, double size,
+                                                          double startTime, const Bullet* bullet) const {
+    double speed = length(velocity);
+    Ray ray{unitId, playerId, origin, Vec2Double(velocity.x / speed, velocity.y / speed), speed, size / 2,
+            startTime, std::numeric_limits<double>::infinity(), bullet};
+
+    // Bullets explode at the first wall they touch. March in steps of half a tile, which is still finer than
+    // a bullet moves in one simulated tick, and refine the last step.
+    double maxDistance = speed * (ticks * tickTime - startTime);
+    double step = 0.5;
+    auto blocked = [&](double distance) {
+        Vec2Double center = pointAt(origin, ray.direction, distance);
+        if (center.x < 0 || center.y < 0 || center.x >= game.level.tiles.size() || center.y >= game.level.tiles[0].size()) {
+            return true;
+        }
+        return checkWallCollision(bulletRect(center, ray.halfSize), game);
+    };
+    for (double distance = 0.0; distance <= maxDistance + step; distance += step) {
+        if (blocked(distance)) {
+            double free = std::max(0.0, distance - step);
+            for (int i = 0; i < 6 && distance > 0.0; ++i) {
+                double middle = (free + distance) / 2;
+                if (blocked(middle)) {
+                    distance = middle;
+                } else {
+                    free = middle;
+                }
+            }
+            ray.wallDistance = distance;
+            break;
+        }
+    }
+    return ray;
+}
+
+std::optional<HitProbabilityEngine::RayHit> HitProbabilityEngine::findUnitHit(const Ray& ray,
+                                                                             const std::vector<UnitTrajectory>& units) const {
+    std::optional<RayHit> result;
+    for (int unitIdx = 0; unitIdx < units.size(); ++unitIdx) {
+        const UnitTrajectory& unit = units[unitIdx];
+        if (unit.unitId == ray.unitId) {
+            continue;
+        }
+        for (int tick = 0; tick < ticks; ++tick) {
+            double rangeEnd = ray.speed * ((tick + 1) * tickTime - ray.startTime);
+            if (rangeEnd <= 0.0) {
+                continue;
+            }
+            double rangeStart = std::max(0.0, ray.speed * (tick * tickTime - ray.startTime));
+            if (rangeStart >= ray.wallDistance || (result && rangeStart >= result->distance)) {
+                break;
+            }
+            // Both the bullet and the unit move linearly during the tick, so the bullet moves linearly
+            // relative to the unit box as well. Entering and leaving the box is found per axis as a part of the tick.
+            const Vec2Double& from = unit.positions[tick];
+            const Vec2Double& to = unit.positions[tick + 1];
+            Vec2Double start = pointAt(ray.origin, ray.direction, rangeStart);
+            Vec2Double end = pointAt(ray.origin, ray.direction, rangeEnd);
+            double startPart = std::clamp(ray.startTime / tickTime - tick, 0.0, 1.0);
+            Vec2Double boxStart(from.x + (to.x - from.x) * startPart, from.y + (to.y - from.y) * startPart);
+            Vec2Double relativeStart(start.x - boxStart.x, start.y - boxStart.y - unit.size.y / 2);
+            Vec2Double relativeMove(end.x - to.x - relativeStart.x, end.y - to.y - unit.size.y / 2 - relativeStart.y);
+            double halfWidth = unit.size.x / 2 + ray.halfSize;
+            double halfHeight = unit.size.y / 2 + ray.halfSize;
+            double enter = 0.0;
+            double exit = 1.0;
+            if (clipSlab(relativeStart.x, relativeMove.x, -halfWidth, halfWidth, enter, exit) &&
+                clipSlab(relativeStart.y, relativeMove.y, -halfHeight, halfHeight, enter, exit)) {
+                enter = rangeStart + (rangeEnd - rangeStart) * enter;
+                if (enter >= ray.wallDistance) {
+                    break;
+                }
+                if (!result || enter < result->distance) {
+                    result = RayHit{unitIdx, tick, enter};
+                }
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+void HitProbabilityEngine::addExplosionEvents(const Bullet& bullet, const Vec2Double& center, int tick,
+                                              const std::vector<UnitTrajectory>& units,
+                                              std::vector<DamageEvent>& events) const {
+    if (!bullet.explosionParams) {
+        return;
+    }
+    double radius = bullet.explosionParams->radius;
+    Rect explosion(center.x - radius, center.y + radius, center.x + radius, center.y - radius);
+    for (const UnitTrajectory& unit : units) {
+        if (intersectRects(explosion, unitRect(unit.positions[tick + 1], unit.size))) {
+            events.push_back(DamageEvent{tick + 1, unit.unitId, double(bullet.explosionParams->damage), true, 1.0, 0, 0.0, 0.0});
+        }
+    }
+}
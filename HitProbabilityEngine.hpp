@@ -0,0 +1,79 @@
+#ifndef _HITPROBABILITYENGINE_HPP_
+#define _HITPROBABILITYENGINE_HPP_
+
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "model/Game.hpp"
+#include "Simulation.hpp"
+
+// Positions of a unit in a hit probability scenario, positions[k] is the position after k ticks.
+struct UnitTrajectory {
+    int unitId;
+    int playerId;
+    Vec2Double size;
+    std::vector<Vec2Double> positions;
+};
+
+// Fan of virtual bullets fired by a unit, the same fan Simulation creates with calcHitProbability.
+struct VirtualShot {
+    int unitId;
+    int playerId;
+    Vec2Double muzzle;
+    double aimAngle;
+    double spread;
+    double bulletSpeed;
+    double bulletSize;
+    // Seconds from the start of the scenario until the bullets start to move
+    double shootTime;
+};
+
+// Closed form replacement of the virtual bullet simulations used for the hit probability. Every bullet is a ray
+// which stops at the first wall, found once by marching along it. A bullet hits the first unit whose box swept
+// over a tick meets the part of the ray the bullet passes during the same tick.
+class HitProbabilityEngine {
+public:
+    HitProbabilityEngine(const Game& game, int ticks, const std::optional<VirtualShot>& shot);
+
+    // Hit masks of the virtual bullets, in the order of the units
+    void getBulletHits(const std::vector<UnitTrajectory>& units, std::array<HitMask, MAX_HIT_UNITS>& hits) const;
+
+    // Damage dealt by the real bullets of the game
+    std::vector<DamageEvent> getRealBulletEvents(const std::vector<UnitTrajectory>& units) const;
+
+private:
+    struct Ray {
+        int unitId;
+        int playerId;
+        Vec2Double origin;
+        Vec2Double direction;
+        double speed;
+        double halfSize;
+        double startTime;
+        double wallDistance;
+        const Bullet* bullet;
+    };
+
+    struct RayHit {
+        int unitIdx;
+        int tick;
+        double distance;
+    };
+
+    Ray createRay(int unitId, int playerId, const Vec2Double& origin, const Vec2Double& velocity, double size,
+                  double startTime, const Bullet* bullet) const;
+
+    std::optional<RayHit> findUnitHit(const Ray& ray, const std::vector<UnitTrajectory>& units) const;
+
+    void addExplosionEvents(const Bullet& bullet, const Vec2Double& center, int tick,
+                            const std::vector<UnitTrajectory>& units, std::vector<DamageEvent>& events) const;
+
+    const Game& game;
+    int ticks;
+    double tickTime;
+    std::vector<Ray> shotRays;
+    std::vector<Ray> bulletRays;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "KinematicPredictor.hpp"
+#include "Util.hpp"
+#include <algorithm>
+
+namespace {
+Rect unitRect(const Vec2Double& position, const Vec2Double& size) {
+    return Rect(position.x - size.x / 2, position.y + size.y, position.x + size.x / 2, position.y);
+}
+}
+
+KinematicPredictor::KinematicPredictor(const Unit& unit, const Game& game, int microTicks)
+    : game(game)
+    , position(unit.position)
+    , size(unit.size)
+    , jumpState(unit.jumpState)
+    , microTicks(microTicks) {
+    ticksMultiplier = 1.0 / (game.properties.ticksPerSecond * microTicks);
+}
+
+void KinematicPredictor::simulateTick(const UnitAction& action, std::optional<int> microTicks) {
+    if (microTicks) {
+        this->microTicks = *microTicks;
+        ticksMultiplier = 1.0 / (game.properties.ticksPerSecond * *microTicks);
+    }
+    for (int i = 0; i < this->microTicks; ++i) {
+        moveX(action);
+        moveY(action);
+    }
+}
+
+const Vec2Double& KinematicPredictor::getPosition() const {
+    return position;
+}
+
+void KinematicPredictor::moveX(const UnitAction& action) {
+    const double vel = std::clamp(
+        action.velocity,
+        -game.properties.unitMaxHorizontalSpeed,
+        game.properties.unitMaxHorizontalSpeed
+    );
+    const double moveDistance = vel * ticksMultiplier;
+
+    auto rect = unitRect(position, size);
+    rect.left += moveDistance;
+    rect.right += moveDistance;
+    if (!checkWallCollision(rect, game)) {
+        position.x += moveDistance;
+    } else if (moveDistance < 0) {
+        position.x = int(position.x) + size.x / 2 + 1e-9;
+    } else {
+        position.x = int(position.x + 1) - size.x / 2 - 1e-9;
+    }
+}
+
+void KinematicPredictor::moveY(const UnitAction& action) {
+    bool padCollision = checkJumpPadCollision(unitRect(position, size), game);
+    if (!padCollision && !areSame(jumpState.speed, game.properties.jumpPadJumpSpeed)
+        && (!jumpState.canJump || !action.jump)) {
+        return fallDown(action);
+    }
+    if (padCollision) {
+        jumpState.speed = game.properties.jumpPadJumpSpeed;
+        jumpState.maxTime = game.properties.jumpPadJumpTime;
+        jumpState.canCancel = false;
+    }
+    double speed;
+    if (!jumpState.canCancel) {
+        if (jumpState.maxTime <= 0.0) {
+            jumpState = JumpState(false, 0.0, 0.0, false);
+            return fallDown(action);
+        }
+        speed = game.properties.jumpPadJumpSpeed;
+    } else if (action.jump) {
+        if (areSame(jumpState.maxTime, 0.0)) {
+            jumpState = JumpState(false, 0.0, 0.0, false);
+            return fallDown(action);
+        }
+        speed = game.properties.unitJumpSpeed;
+    } else {
+        return;
+    }
+    jumpState.maxTime -= ticksMultiplier;
+    const double moveDistance = speed * ticksMultiplier;
+    auto rect = unitRect(position, size);
+    rect.top += moveDistance;
+    rect.bottom += moveDistance;
+    if (checkWallCollision(rect, game)) {
+        jumpState.canJump = false;
+    } else {
+        position.y += moveDistance;
+    }
+}
+
+void KinematicPredictor::fallDown(const UnitAction& action) {
+    const double moveDistance = game.properties.unitFallSpeed * ticksMultiplier;
+
+    auto rect = unitRect(position, size);
+    bool collisionBeforeMove = checkWallCollision(rect, game, action.jumpDown);
+    rect.top -= moveDistance;
+    rect.bottom -= moveDistance;
+
+    if (checkWallCollision(rect, game, action.jumpDown, collisionBeforeMove)) {
+        jumpState = JumpState(true, game.properties.unitJumpSpeed, game.properties.unitJumpTime, true);
+    } else {
+        jumpState = JumpState(false, 0.0, 0.0, false);
+        position.y -= moveDistance;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef _KINEMATICPREDICTOR_HPP_
+#define _KINEMATICPREDICTOR_HPP_
+
+
+#include <optional>
+#include "model/Game.hpp"
+#include "model/UnitAction.hpp"
+
+// Movement of a single unit simulated against the level only. Follows Simulation::moveX, moveY and fallDown
+// without copying the Game, collisions with the other units are ignored.
+class KinematicPredictor {
+public:
+    KinematicPredictor(const Unit& unit, const Game& game, int microTicks = 100);
+
+    void simulateTick(const UnitAction& action, std::optional<int> microTicks = std::nullopt);
+
+    const Vec2Double& getPosition() const;
+
+private:
+    void moveX(const UnitAction& action);
+    void moveY(const UnitAction& action);
+    void fallDown(const UnitAction& action);
+
+    const Game& game;
+    Vec2Double position;
+    Vec2Double size;
+    JumpState jumpState;
+    int microTicks;
+    double ticksMultiplier;
+};
+
+#endif
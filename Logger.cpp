@@ -0,0 +1,177 @@
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+
+std::atomic<int> Logger::LEVEL(int(LogLevel::OFF));
+std::atomic<bool> Logger::RUNNING(false);
+std::atomic<size_t> Logger::DROPPED(0);
+std::atomic<size_t> Logger::TRUNCATED(0);
+std::atomic<size_t> Logger::ENQUEUE_POS(0);
+size_t Logger::DEQUEUE_POS = 0;
+std::array<Logger::Slot, Logger::SLOTS_COUNT> Logger::SLOTS;
+std::FILE* Logger::OUTPUT = nullptr;
+std::thread Logger::WRITER;
+
+namespace {
+const char* LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "off"};
+
+constexpr char TRUNCATION_MARKER[] = "...";
+
+// Lines are built in buffers of the thread, so the hot paths don't allocate once they have grown. Lines logged while
+// another one is built take the next buffer, a deque keeps the buffers in place when it grows.
+thread_local std::deque<std::string> lineBuffers;
+thread_local size_t lineDepth = 0;
+
+std::string& acquireLineBuffer() {
+    if (lineDepth == lineBuffers.size()) {
+        lineBuffers.emplace_back();
+    }
+    std::string& buffer = lineBuffers[lineDepth++];
+    buffer.clear();
+    return buffer;
+}
+}
+
+void Logger::start(LogLevel level, const std::string& path) {
+    if (RUNNING) {
+        return;
+    }
+    for (size_t i = 0; i < SLOTS_COUNT; ++i) {
+        SLOTS[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    ENQUEUE_POS = 0;
+    DEQUEUE_POS = 0;
+    OUTPUT = path.empty() ? stderr : std::fopen(path.c_str(), "w");
+    if (OUTPUT == nullptr) {
+        std::fprintf(stderr, "Failed to open the log file %s, logging to stderr\n", path.c_str());
+        OUTPUT = stderr;
+    }
+    RUNNING = true;
+    WRITER = std::thread(&Logger::writerLoop);
+    LEVEL = int(level);
+}
+
+void Logger::stop() {
+    if (!RUNNING) {
+        return;
+    }
+    LEVEL = int(LogLevel::OFF);
+    RUNNING = false;
+    WRITER.join();
+    if (DROPPED > 0) {
+        std::fprintf(OUTPUT, "%zu log lines were dropped\n", DROPPED.load());
+    }
+    if (TRUNCATED > 0) {
+        std::fprintf(OUTPUT, "%zu log lines were truncated to %zu characters\n", TRUNCATED.load(), LINE_SIZE);
+    }
+    if (OUTPUT != stderr) {
+        std::fclose(OUTPUT);
+    } else {
+        std::fflush(OUTPUT);
+    }
+    OUTPUT = nullptr;
+}
+
+LogLevel Logger::parseLevel(const std::string& name, LogLevel defaultLevel) {
+    for (int level = 0; level <= int(LogLevel::OFF); ++level) {
+        if (name == LEVEL_NAMES[level]) {
+            return LogLevel(level);
+        }
+    }
+    return defaultLevel;
+}
+
+// Bounded multi producer queue of D. Vyukov: a slot is free for the position when its sequence equals it
+// and holds a line when the sequence is one more
+void Logger::push(LogLevel level, const std::string& text) {
+    size_t pos = ENQUEUE_POS.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &SLOTS[pos % SLOTS_COUNT];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == pos) {
+            if (ENQUEUE_POS.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (sequence < pos) {
+            DROPPED.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = ENQUEUE_POS.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    if (text.size() <= LINE_SIZE) {
+        slot->length = text.size();
+        text.copy(slot->text, slot->length);
+    } else {
+        constexpr size_t markerSize = sizeof(TRUNCATION_MARKER) - 1;
+        text.copy(slot->text, LINE_SIZE - markerSize);
+        std::memcpy(slot->text + LINE_SIZE - markerSize, TRUNCATION_MARKER, markerSize);
+        slot->length = LINE_SIZE;
+        TRUNCATED.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::pop(std::FILE* file) {
+    Slot& slot = SLOTS[DEQUEUE_POS % SLOTS_COUNT];
+    if (slot.sequence.load(std::memory_order_acquire) != DEQUEUE_POS + 1) {
+        return false;
+    }
+    std::fwrite(slot.text, 1, slot.length, file);
+    std::fputc('\n', file);
+    slot.sequence.store(DEQUEUE_POS + SLOTS_COUNT, std::memory_order_release);
+    ++DEQUEUE_POS;
+    return true;
+}
+
+void Logger::writerLoop() {
+    while (true) {
+        bool running = RUNNING;
+        bool written = false;
+        while (pop(OUTPUT)) {
+            written = true;
+        }
+        if (!running) {
+            break;
+        }
+        if (written) {
+            std::fflush(OUTPUT);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+LogLine::LogLine(LogLevel level) : level(level), text(acquireLineBuffer()) {
+}
+
+LogLine::~LogLine() {
+    Logger::push(level, text);
+    --lineDepth;
+}
+
+LogLine& LogLine::operator<<(const std::string& value) {
+    text += value;
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const char* value) {
+    text += value;
+    return *this;
+}
+
+LogLine& LogLine::operator<<(char value) {
+    text += value;
+    return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+    text.append(buffer, length);
+    return *this;
+}
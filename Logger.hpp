@@ -0,0 +1,100 @@
+#ifndef _LOGGER_HPP_
+#define _LOGGER_HPP_
+
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+enum class LogLevel {
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    OFF = 4
+};
+
+// Statements below this level are removed at compile time
+#ifndef AICUP_LOG_MIN_LEVEL
+#define AICUP_LOG_MIN_LEVEL 0
+#endif
+
+// Usage: LOG(DEBUG) << "score: " << score;
+// The arguments are only evaluated when the level is enabled, the line is formatted into a thread local buffer and
+// queued, the file is written by the background thread. An argument may log itself, e.g. in its toString, the inner
+// line takes the next buffer of the thread and is queued before the outer one.
+#define LOG(level) \
+    if (!(int(LogLevel::level) >= AICUP_LOG_MIN_LEVEL && Logger::isEnabled(LogLevel::level))) {} \
+    else LogLine(LogLevel::level)
+
+// Lines are passed to the writer thread through a bounded lock free ring. Producers never wait: when the ring is full
+// the line is dropped and counted. Lines longer than a slot end with "..." and are counted as well.
+class Logger {
+public:
+    // Starts the writer thread, lines go to the file or to stderr if the path is empty
+    static void start(LogLevel level, const std::string& path);
+    // Writes the queued lines and stops the writer thread
+    static void stop();
+
+    static bool isEnabled(LogLevel level) {
+        return int(level) >= LEVEL.load(std::memory_order_relaxed);
+    }
+
+    static LogLevel parseLevel(const std::string& name, LogLevel defaultLevel);
+
+    static void push(LogLevel level, const std::string& text);
+
+private:
+    static constexpr size_t SLOTS_COUNT = 4096;
+    static constexpr size_t LINE_SIZE = 240;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        size_t length;
+        char text[LINE_SIZE];
+    };
+
+    static void writerLoop();
+    static bool pop(std::FILE* file);
+
+    static std::atomic<int> LEVEL;
+    static std::atomic<bool> RUNNING;
+    static std::atomic<size_t> DROPPED;
+    static std::atomic<size_t> TRUNCATED;
+    static std::atomic<size_t> ENQUEUE_POS;
+    static size_t DEQUEUE_POS;
+    static std::array<Slot, SLOTS_COUNT> SLOTS;
+    static std::FILE* OUTPUT;
+    static std::thread WRITER;
+};
+
+// One log line, queued when destroyed
+class LogLine {
+public:
+    explicit LogLine(LogLevel level);
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    LogLine& operator<<(const std::string& value);
+    LogLine& operator<<(const char* value);
+    LogLine& operator<<(char value);
+    LogLine& operator<<(double value);
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    LogLine& operator<<(T value) {
+        text += std::to_string(value);
+        return *this;
+    }
+
+private:
+    LogLevel level;
+    std::string& text;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "MessageReader.hpp"
+
+namespace {
+constexpr int WEAPON_TYPES_COUNT = 3;
+constexpr int TILES_COUNT = 5;
+constexpr int MINE_STATES_COUNT = 4;
+
+// Objects behind shared pointers are overwritten in place only when nobody else holds them,
+// the strategy keeps copies of the game between ticks
+template<typename T>
+T& reuse(std::shared_ptr<T>& ptr) {
+    if (!ptr || ptr.use_count() > 1) {
+        ptr = std::make_shared<T>();
+    }
+    return *ptr;
+}
+
+template<typename T>
+T& reuseItem(std::shared_ptr<Item>& item) {
+    if (!item || item.use_count() > 1 || !dynamic_cast<T*>(item.get())) {
+        item = std::make_shared<T>();
+    }
+    return static_cast<T&>(*item);
+}
+}
+
+MessageReader::MessageReader(std::shared_ptr<InputStream> stream)
+    : stream(std::move(stream))
+    , buffer(INITIAL_CAPACITY) {
+}
+
+bool MessageReader::readServerMessage(PlayerView& playerView) {
+    messageStart = pos;
+    if (!readBool()) {
+        return false;
+    }
+    playerView.myId = readInt();
+    read(playerView.game);
+    return true;
+}
+
+const char* MessageReader::lastMessageData() const {
+    return buffer.data() + messageStart;
+}
+
+size_t MessageReader::lastMessageSize() const {
+    return pos - messageStart;
+}
+
+void MessageReader::require(size_t count) {
+    if (messageStart > 0) {
+        std::memmove(buffer.data(), buffer.data() + messageStart, end - messageStart);
+        end -= messageStart;
+        pos -= messageStart;
+        messageStart = 0;
+    }
+    count += pos;
+    if (buffer.size() < count) {
+        buffer.resize(std::max(count, buffer.size() * 2));
+    }
+    while (end < count) {
+        end += stream->readSome(buffer.data() + end, buffer.size() - end);
+    }
+}
+
+bool MessageReader::matchesStaticSections() {
+    if (staticSections.empty()) {
+        return false;
+    }
+    size_t matched = 0;
+    while (matched < staticSections.size()) {
+        if (end - pos == matched) {
+            require(matched + 1);
+        }
+        size_t count = std::min(staticSections.size(), end - pos) - matched;
+        if (std::memcmp(buffer.data() + pos + matched, staticSections.data() + matched, count) != 0) {
+            return false;
+        }
+        matched += count;
+    }
+    return true;
+}
+
+void MessageReader::read(Game& game) {
+    game.currentTick = readInt();
+    if (matchesStaticSections()) {
+        pos += staticSections.size();
+    } else {
+        size_t offset = pos - messageStart;
+        read(game.properties);
+        read(game.level);
+        staticSections.assign(buffer.begin() + messageStart + offset, buffer.begin() + pos);
+    }
+    game.players.resize(readInt());
+    for (Player& player : game.players) {
+        read(player);
+    }
+    game.units.resize(readInt());
+    for (Unit& unit : game.units) {
+        read(unit);
+    }
+    game.bullets.resize(readInt());
+    for (Bullet& bullet : game.bullets) {
+        read(bullet);
+    }
+    game.mines.resize(readInt());
+    for (Mine& mine : game.mines) {
+        read(mine);
+    }
+    game.lootBoxes.resize(readInt());
+    for (LootBox& lootBox : game.lootBoxes) {
+        read(lootBox);
+    }
+}
+
+void MessageReader::read(Properties& properties) {
+    properties.maxTickCount = readInt();
+    properties.teamSize = readInt();
+    properties.ticksPerSecond = readDouble();
+    properties.updatesPerTick = readInt();
+    read(properties.lootBoxSize);
+    read(properties.unitSize);
+    properties.unitMaxHorizontalSpeed = readDouble();
+    properties.unitFallSpeed = readDouble();
+    properties.unitJumpTime = readDouble();
+    properties.unitJumpSpeed = readDouble();
+    properties.jumpPadJumpTime = readDouble();
+    properties.jumpPadJumpSpeed = readDouble();
+    properties.unitMaxHealth = readInt();
+    properties.healthPackHealth = readInt();
+    int weaponParamsSize = readInt();
+    if (properties.weaponParams.size() > weaponParamsSize) {
+        properties.weaponParams.clear();
+    }
+    for (int i = 0; i < weaponParamsSize; ++i) {
+        auto weaponType = readEnum<WeaponType>(WEAPON_TYPES_COUNT);
+        read(properties.weaponParams[weaponType]);
+    }
+    read(properties.mineSize);
+    read(properties.mineExplosionParams);
+    properties.minePrepareTime = readDouble();
+    properties.mineTriggerTime = readDouble();
+    properties.mineTriggerRadius = readDouble();
+    properties.killScore = readInt();
+}
+
+void MessageReader::read(Level& level) {
+    level.tiles.resize(readInt());
+    for (std::vector<Tile>& column : level.tiles) {
+        column.resize(readInt());
+        for (Tile& tile : column) {
+            tile = readEnum<Tile>(TILES_COUNT);
+        }
+    }
+}
+
+void MessageReader::read(Vec2Double& vec) {
+    vec.x = readDouble();
+    vec.y = readDouble();
+}
+
+void MessageReader::read(WeaponParams& params) {
+    params.magazineSize = readInt();
+    params.fireRate = readDouble();
+    params.reloadTime = readDouble();
+    params.minSpread = readDouble();
+    params.maxSpread = readDouble();
+    params.recoil = readDouble();
+    params.aimSpeed = readDouble();
+    params.bullet.speed = readDouble();
+    params.bullet.size = readDouble();
+    params.bullet.damage = readInt();
+    if (readBool()) {
+        read(reuse(params.explosion));
+    } else {
+        params.explosion.reset();
+    }
+}
+
+void MessageReader::read(ExplosionParams& params) {
+    params.radius = readDouble();
+    params.damage = readInt();
+}
+
+void MessageReader::read(Player& player) {
+    player.id = readInt();
+    player.score = readInt();
+}
+
+void MessageReader::read(Unit& unit) {
+    unit.playerId = readInt();
+    unit.id = readInt();
+    unit.health = readInt();
+    read(unit.position);
+    read(unit.size);
+    unit.jumpState.canJump = readBool();
+    unit.jumpState.speed = readDouble();
+    unit.jumpState.maxTime = readDouble();
+    unit.jumpState.canCancel = readBool();
+    unit.walkedRight = readBool();
+    unit.stand = readBool();
+    unit.onGround = readBool();
+    unit.onLadder = readBool();
+    unit.mines = readInt();
+    if (readBool()) {
+        if (!unit.weapon) {
+            unit.weapon.emplace();
+        }
+        read(*unit.weapon);
+    } else {
+        unit.weapon.reset();
+    }
+}
+
+void MessageReader::read(Weapon& weapon) {
+    weapon.typ = readEnum<WeaponType>(WEAPON_TYPES_COUNT);
+    read(weapon.params);
+    weapon.magazine = readInt();
+    weapon.wasShooting = readBool();
+    weapon.spread = readDouble();
+    weapon.fireTimer = readBool() ? std::optional<double>(readDouble()) : std::nullopt;
+    weapon.lastAngle = readBool() ? std::optional<double>(readDouble()) : std::nullopt;
+    weapon.lastFireTick = readBool() ? std::optional<int>(readInt()) : std::nullopt;
+}
+
+void MessageReader::read(Bullet& bullet) {
+    bullet.weaponType = readEnum<WeaponType>(WEAPON_TYPES_COUNT);
+    bullet.unitId = readInt();
+    bullet.playerId = readInt();
+    read(bullet.position);
+    read(bullet.velocity);
+    bullet.damage = readInt();
+    bullet.size = readDouble();
+    if (readBool()) {
+        read(reuse(bullet.explosionParams));
+    } else {
+        bullet.explosionParams.reset();
+    }
+    bullet.virtualParams.reset();
+    bullet.real = true;
+}
+
+void MessageReader::read(Mine& mine) {
+    mine.playerId = readInt();
+    read(mine.position);
+    read(mine.size);
+    mine.state = readEnum<MineState>(MINE_STATES_COUNT);
+    if (readBool()) {
+        reuse(mine.timer) = readDouble();
+    } else {
+        mine.timer.reset();
+    }
+    mine.triggerRadius = readDouble();
+    read(mine.explosionParams);
+}
+
+void MessageReader::read(LootBox& lootBox) {
+    read(lootBox.position);
+    read(lootBox.size);
+    switch (readInt()) {
+    case 0:
+        reuseItem<Item::HealthPack>(lootBox.item).health = readInt();
+        break;
+    case 1:
+        reuseItem<Item::Weapon>(lootBox.item).weaponType = readEnum<WeaponType>(WEAPON_TYPES_COUNT);
+        break;
+    case 2:
+        reuseItem<Item::Mine>(lootBox.item);
+        break;
+    default:
+        throw std::runtime_error("Unexpected discriminant value");
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef _MESSAGEREADER_HPP_
+#define _MESSAGEREADER_HPP_
+
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "Stream.hpp"
+#include "model/PlayerView.hpp"
+
+// Decoder of the server messages working on a reusable buffer. Every recv takes all the bytes the server has sent
+// so far, a message normally arrives in one piece, and the fields are decoded by inline memcpy readers without
+// a virtual call per field. Decoding into the previous PlayerView reuses the capacity of its vectors.
+// The properties and the level are resent every tick, their raw bytes are compared with the previous message
+// and they are only decoded again when something has changed.
+class MessageReader {
+public:
+    explicit MessageReader(std::shared_ptr<InputStream> stream);
+
+    // Reads the next ServerMessageGame into the view, returns false when the server has nothing more to send
+    bool readServerMessage(PlayerView& playerView);
+
+    // Raw bytes of the message read last, valid until the next read
+    const char* lastMessageData() const;
+    size_t lastMessageSize() const;
+
+private:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static constexpr bool BIG_ENDIAN_MACHINE = true;
+#else
+    static constexpr bool BIG_ENDIAN_MACHINE = false;
+#endif
+    static constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+
+    template<typename T>
+    T readValue() {
+        if (end - pos < sizeof(T)) {
+            require(sizeof(T));
+        }
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, buffer.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        if constexpr (BIG_ENDIAN_MACHINE) {
+            std::reverse(bytes, bytes + sizeof(T));
+        }
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    bool readBool() {
+        return readValue<char>() != 0;
+    }
+
+    int readInt() {
+        return readValue<int>();
+    }
+
+    double readDouble() {
+        return readValue<double>();
+    }
+
+    template<typename E>
+    E readEnum(int valuesCount) {
+        int value = readInt();
+        if (value < 0 || value >= valuesCount) {
+            throw std::runtime_error("Unexpected discriminant value");
+        }
+        return E(value);
+    }
+
+    // Makes at least count bytes available after pos, the bytes of the current message are kept in the buffer
+    void require(size_t count);
+
+    // Whether the next bytes repeat the static sections of the previous message, waits for more bytes
+    // only while the ones received so far match
+    bool matchesStaticSections();
+
+    void read(Game& game);
+    void read(Properties& properties);
+    void read(Level& level);
+    void read(Vec2Double& vec);
+    void read(WeaponParams& params);
+    void read(ExplosionParams& params);
+    void read(Player& player);
+    void read(Unit& unit);
+    void read(Weapon& weapon);
+    void read(Bullet& bullet);
+    void read(Mine& mine);
+    void read(LootBox& lootBox);
+
+    std::shared_ptr<InputStream> stream;
+    std::vector<char> buffer;
+    size_t pos = 0;
+    size_t end = 0;
+    size_t messageStart = 0;
+    // Raw properties and level of the last decoded message
+    std::vector<char> staticSections;
+};
+
+#endif
@@ -1,13 +1,154 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
 #include "MyStrategy.hpp"
+#include "GameEngine.hpp"
 #include "Util.hpp"
 #include "StrategyGenerator.hpp"
+#include "KinematicPredictor.hpp"
+#include "HitProbabilityEngine.hpp"
+#include "AngleMath.hpp"
+#include "Logger.hpp"
 
 std::unordered_map<std::string, int> MyStrategy::PERF;
+std::unordered_map<std::string, int> MyStrategy::COUNTERS;
+std::mutex MyStrategy::PERF_MUTEX;
+std::atomic<int> MyStrategy::PLANNING_PASSES(0);
+
+namespace {
+// Aims memoized by the current thread, counters are reported when the table is dropped
+struct AimMemoTable {
+    int planningPass = -1;
+    int hits = 0;
+    int misses = 0;
+    std::unordered_map<AimKey, AimMemo, AimKeyHash> aims;
+};
+thread_local AimMemoTable aimMemoTable;
+
+// Timers and counters of one thread. Its mutex is only contended while mergePerf reads the table.
+struct PerfTable {
+    std::mutex mutex;
+    std::unordered_map<const char*, int> perf;
+    std::unordered_map<const char*, int> counters;
+};
+// Tables of all threads which ever added something, they outlive their threads until merged
+std::mutex perfTablesMutex;
+std::vector<std::shared_ptr<PerfTable>> perfTables;
+
+PerfTable& localPerfTable() {
+    thread_local std::shared_ptr<PerfTable> table = [] {
+        auto newTable = std::make_shared<PerfTable>();
+        std::lock_guard<std::mutex> lock(perfTablesMutex);
+        perfTables.push_back(newTable);
+        return newTable;
+    }();
+    return *table;
+}
+
+// My unit shoots in the first two ticks and stands, the enemy stands in the first tick and dodges in one of the ways.
+// The first tick is simulated with 10 microticks, the rest with one.
+constexpr int HIT_PROBABILITY_TICKS = 25;
+constexpr int HIT_PROBABILITY_FIRST_MICROTICKS = 10;
+constexpr std::array<ActionSequence, 4> HIT_PROBABILITY_ENEMY_ACTIONS = {
+    ActionSequence({HIT_PROBABILITY_TICKS, 1, true, false, false}),
+    ActionSequence({HIT_PROBABILITY_TICKS, -1, true, false, false}),
+    ActionSequence({HIT_PROBABILITY_TICKS, 1, false, true, false}),
+    ActionSequence({HIT_PROBABILITY_TICKS, -1, false, true, false})
+};
+int unitIndex(const Game& game, int unitId) {
+    for (int i = 0; i < game.units.size(); ++i) {
+        if (game.units[i].id == unitId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+constexpr ActionSequence HIT_PROBABILITY_MY_ACTIONS =
+    ActionSequence({2, 0, false, false}).then({HIT_PROBABILITY_TICKS - 2, 0, false, false, false});
+
+// Same tolerance matchesPlan accepts between the planned and the real position of a unit
+constexpr double SPECULATION_PRECISION = 1e-2;
+
+bool sameOptional(const std::optional<double>& a, const std::optional<double>& b) {
+    return a.has_value() == b.has_value() && (!a || areSame(*a, *b, SPECULATION_PRECISION));
+}
+
+bool sameJumpState(const JumpState& a, const JumpState& b) {
+    return a.canJump == b.canJump && a.canCancel == b.canCancel && areSame(a.speed, b.speed, SPECULATION_PRECISION) &&
+           areSame(a.maxTime, b.maxTime, SPECULATION_PRECISION);
+}
+
+// Only the weapon types of the enemies are compared, their aim isn't predicted and nothing speculated depends on it
+bool samePredictedUnit(const Unit& predicted, const Unit& real, int playerId) {
+    if (predicted.id != real.id || predicted.health != real.health || predicted.mines != real.mines ||
+        !areSame(predicted.position.x, real.position.x, SPECULATION_PRECISION) ||
+        !areSame(predicted.position.y, real.position.y, SPECULATION_PRECISION) ||
+        !sameJumpState(predicted.jumpState, real.jumpState) || bool(predicted.weapon) != bool(real.weapon)) {
+        return false;
+    }
+    if (!real.weapon) {
+        return true;
+    }
+    const Weapon& a = *predicted.weapon;
+    const Weapon& b = *real.weapon;
+    return a.typ == b.typ && (real.playerId != playerId ||
+           (a.magazine == b.magazine && areSame(a.spread, b.spread, SPECULATION_PRECISION) &&
+            sameOptional(a.fireTimer, b.fireTimer) && sameOptional(a.lastAngle, b.lastAngle)));
+}
+
+bool matchesPrediction(const Game& predicted, const Game& real, int playerId) {
+    if (predicted.units.size() != real.units.size() || predicted.bullets.size() != real.bullets.size() ||
+        predicted.mines.size() != real.mines.size() || predicted.lootBoxes.size() != real.lootBoxes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < real.units.size(); ++i) {
+        if (!samePredictedUnit(predicted.units[i], real.units[i], playerId)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < real.bullets.size(); ++i) {
+        const Bullet& a = predicted.bullets[i];
+        const Bullet& b = real.bullets[i];
+        if (a.unitId != b.unitId || !areSame(a.position.x, b.position.x, SPECULATION_PRECISION) ||
+            !areSame(a.position.y, b.position.y, SPECULATION_PRECISION)) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+PlannerConfig PlannerConfig::fromEnvironment(const std::string& prefix) {
+    PlannerConfig config;
+    if (const char* beamWidth = std::getenv((prefix + "BEAM_WIDTH").c_str())) {
+        config.beamWidth = atoi(beamWidth);
+    }
+    if (const char* budget = std::getenv((prefix + "PLANNING_BUDGET_MS").c_str())) {
+        config.planningBudgetMs = atoi(budget);
+    }
+    if (const char* debugEvents = std::getenv((prefix + "DEBUG_EVENTS").c_str())) {
+        config.debugEvents = atoi(debugEvents) != 0;
+    }
+    if (const char* exposureCost = std::getenv((prefix + "EXPOSURE_COST").c_str())) {
+        config.exposureCost = atof(exposureCost);
+    }
+    if (const char* hitProbability = std::getenv((prefix + "HIT_PROBABILITY").c_str())) {
+        if (std::string(hitProbability) == "reference") {
+            config.hitProbabilityMode = HitProbabilityMode::REFERENCE;
+        } else if (std::string(hitProbability) == "validate") {
+            config.hitProbabilityMode = HitProbabilityMode::VALIDATE;
+        }
+    }
+    return config;
+}
 
-MyStrategy::MyStrategy() {
+MyStrategy::MyStrategy(int threadsCount, PlannerConfig plannerConfig)
+    : threadPool(std::make_unique<ThreadPool>(threadsCount))
+    , plannerConfig(std::move(plannerConfig)) {
     for (auto& p: paths) {
         p.fill(10000);
     }
@@ -15,22 +156,78 @@ MyStrategy::MyStrategy() {
     pathsBuilt = false;
 }
 
-UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debug) {
-    if (!pathsBuilt) {
-        auto t1 = std::chrono::high_resolution_clock::now();
-        buildPathGraph(unit, game, debug);
-        if (MyStrategy::PERF.find("buildPathGraph") == MyStrategy::PERF.end()) {
-            MyStrategy::PERF["buildPathGraph"] = 0;
+void MyStrategy::addPerf(const char* name, std::chrono::high_resolution_clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    PerfTable& table = localPerfTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.perf[name] += elapsed;
+}
+
+void MyStrategy::addCounter(const char* name, int value) {
+    PerfTable& table = localPerfTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    table.counters[name] += value;
+}
+
+void MyStrategy::mergePerf() {
+    std::lock_guard<std::mutex> tablesLock(perfTablesMutex);
+    std::lock_guard<std::mutex> lock(PERF_MUTEX);
+    for (const auto& table : perfTables) {
+        std::lock_guard<std::mutex> tableLock(table->mutex);
+        for (const auto& [name, value] : table->perf) {
+            PERF[name] += value;
+        }
+        for (const auto& [name, value] : table->counters) {
+            COUNTERS[name] += value;
         }
-        MyStrategy::PERF["buildPathGraph"] += std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now() - t1).count();
+        table->perf.clear();
+        table->counters.clear();
+    }
+}
+
+std::unordered_map<int, UnitAction> MyStrategy::getActions(const PlayerView& playerView, Debug& debug) {
+    const Game& game = playerView.game;
+    prepareTick(game, playerView.myId, debug);
+
+    std::unordered_map<int, UnitAction> actions;
+    for (const Unit& unit : tickContext.myUnits) {
+        actions[unit.id] = getAction(unit, game, debug);
+
+        // Teammates planned after this unit simulate it following its fresh plan
+        auto planIt = plans.find(unit.id);
+        if (planIt != plans.end() && planIt->second.tick == game.currentTick) {
+            tickContext.teamPlans[unit.id] = planIt->second.actions;
+        }
+    }
+    return actions;
+}
+
+void MyStrategy::prepareTick(const Game& game, int playerId, Debug& debug) {
+    mergePerf();
+    if (speculation.tick != -1) {
+        speculation.valid = speculation.tick == game.currentTick && matchesPrediction(speculation.game, game, playerId);
+        MyStrategy::addCounter(speculation.valid ? "speculationHits" : "speculationMisses");
+    }
+    tickContext.tick = game.currentTick;
+    tickContext.playerId = playerId;
+    tickContext.myUnits.clear();
+    tickContext.enemyUnits.clear();
+    for (const Unit& other : game.units) {
+        if (other.playerId == playerId) {
+            tickContext.myUnits.push_back(other);
+        } else {
+            tickContext.enemyUnits.push_back(other);
+        }
+    }
+
+    if (!pathsBuilt && !tickContext.myUnits.empty()) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        buildPathGraph(tickContext.myUnits[0], game, debug);
+        MyStrategy::addPerf("buildPathGraph", t1);
         t1 = std::chrono::high_resolution_clock::now();
         floydWarshall();
-        if (MyStrategy::PERF.find("floydWarshall") == MyStrategy::PERF.end()) {
-            MyStrategy::PERF["floydWarshall"] = 0;
-        }
-        MyStrategy::PERF["floydWarshall"] += std::chrono::duration_cast<std::chrono::microseconds>(
-            std::chrono::high_resolution_clock::now() - t1).count();
+        MyStrategy::addPerf("floydWarshall", t1);
         pathsBuilt = true;
 
         int isPathFilledCount = 0;
@@ -39,14 +236,25 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
                 ++isPathFilledCount;
             }
         }
-        std::cerr << "PATHS SIZE:" << isPathFilledCount << '\n';
+        LOG(INFO) << "PATHS SIZE:" << isPathFilledCount;
+    }
+    if (!visibility.isBuilt()) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        visibility.build(game.level, *threadPool);
+        MyStrategy::addPerf("buildVisibility", t1);
+    }
+    if (pathsBuilt) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        int recomputed = exposure.update(tickContext.enemyUnits, game, visibility, isPathFilled);
+        MyStrategy::addPerf("updateExposure", t1);
+        MyStrategy::addCounter("exposureRecomputes", recomputed);
     }
 
     if (game.currentTick % 100 == 0) {
         int myPoints = 0;
         int enemyPoints = 0;
         for (const Player& player : game.players) {
-            if (player.id == unit.playerId) {
+            if (player.id == playerId) {
                 myPoints += player.score;
             } else {
                 enemyPoints += player.score;
@@ -58,7 +266,162 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
             scoreMultiplier = -1.5;
         }
         lastSumPoints = myPoints + enemyPoints;
-        std::cerr << "score multiplier: " << scoreMultiplier << '\n';
+        LOG(INFO) << "score multiplier: " << scoreMultiplier;
+
+        // Responses were chosen with the old multiplier, this also keeps the cache from growing forever
+        std::lock_guard<std::mutex> lock(enemyResponsesMutex);
+        enemyResponses.clear();
+    }
+    invalidateEnemyResponses(game, playerId);
+    planningPass = ++PLANNING_PASSES;
+
+    if (simulation) {
+        simulation->game.currentTick = game.currentTick;
+        simulation->bullets = game.bullets;
+    } else {
+        simulation = std::make_shared<Simulation>(Simulation(game, playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.5), true, true, false));
+    }
+
+    // Every per-unit entry exists before the units are planned, so concurrently planned units only touch their own
+    for (const Unit& myU : tickContext.myUnits) {
+        suicide.emplace(myU.id, false);
+        unitTargetWeapons.emplace(myU.id, std::nullopt);
+        plans.emplace(myU.id, Plan{-1});
+    }
+    if (game.currentTick % 10 == 0) {
+        assignTargetWeapons(game, playerId, debug);
+    }
+
+    // Until a unit is planned on this tick its teammates assume it keeps following the previous plan
+    tickContext.teamPlans.clear();
+    for (const Unit& myU : tickContext.myUnits) {
+        auto planIt = plans.find(myU.id);
+        if (planIt != plans.end() && planIt->second.tick == game.currentTick - 1 && !planIt->second.actions.empty()) {
+            tickContext.teamPlans[myU.id] = planIt->second.actions.shifted();
+        }
+    }
+}
+
+void MyStrategy::speculate(const PlayerView& playerView, const std::unordered_map<int, UnitAction>& actions,
+                           Debug& debug, const std::atomic<bool>& cancelled) {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    const Game& game = playerView.game;
+    speculation = Speculation();
+    if (!pathsBuilt || game.currentTick + 1 >= game.properties.maxTickCount) {
+        return;
+    }
+
+    // My units do what was just sent, the enemies dodge the way the planner expects them to and hold their fire
+    std::unordered_map<int, UnitAction> predictedActions = actions;
+    {
+        std::lock_guard<std::mutex> lock(enemyResponsesMutex);
+        for (const Unit& enemy : game.units) {
+            if (enemy.playerId == playerView.myId) {
+                continue;
+            }
+            const Unit* nearestUnit = nullptr;
+            for (const Unit& u : game.units) {
+                if (u.playerId == playerView.myId &&
+                    (!nearestUnit || distanceSqr(u.position, enemy.position) < distanceSqr(nearestUnit->position, enemy.position))) {
+                    nearestUnit = &u;
+                }
+            }
+            auto responseIt = nearestUnit ? enemyResponses.find(getEnemyResponseKey(*nearestUnit, enemy)) : enemyResponses.end();
+            UnitAction action = responseIt != enemyResponses.end() ? responseIt->second.action : StrategyGenerator::getAction(0, false, false);
+            action.shoot = false;
+            action.plantMine = false;
+            predictedActions[enemy.id] = action;
+        }
+    }
+    GameEngine engine(game, game.currentTick);
+    engine.tick(predictedActions);
+    speculation.game = engine.getGame();
+    speculation.tick = speculation.game.currentTick;
+    const Game& predicted = speculation.game;
+
+    std::vector<const Unit*> myUnits;
+    std::vector<const Unit*> enemyUnits;
+    for (const Unit& u : predicted.units) {
+        (u.playerId == playerView.myId ? myUnits : enemyUnits).push_back(&u);
+    }
+    // The queries of getAction in its order, the cheap ones only to find the nearest enemy
+    std::vector<const Unit*> nearestEnemies;
+    for (const Unit* unit : myUnits) {
+        const Unit* nearestEnemy = nullptr;
+        double minDistance = 10000000.0;
+        for (const Unit* enemy : enemyUnits) {
+            if (cancelled) {
+                return;
+            }
+            double distance = speculatePathDistance(unit->position, enemy->position, *unit, predicted, debug);
+            if (distance < minDistance) {
+                minDistance = distance;
+                nearestEnemy = enemy;
+            }
+        }
+        nearestEnemies.push_back(nearestEnemy);
+        if (!nearestEnemy) {
+            continue;
+        }
+        for (const LootBox& lootBox : predicted.lootBoxes) {
+            if (cancelled) {
+                return;
+            }
+            if (std::dynamic_pointer_cast<Item::HealthPack>(lootBox.item)) {
+                speculatePathDistance(unit->position, lootBox.position, *unit, predicted, debug);
+                speculatePathDistance(nearestEnemy->position, lootBox.position, *nearestEnemy, predicted, debug);
+            } else if (std::dynamic_pointer_cast<Item::Mine>(lootBox.item) && unit->mines < 2) {
+                speculatePathDistance(unit->position, lootBox.position, *unit, predicted, debug);
+            }
+        }
+    }
+
+    // Validation mode compares both estimates on every real shot
+    if (plannerConfig.hitProbabilityMode != HitProbabilityMode::VALIDATE) {
+        for (size_t i = 0; i < myUnits.size(); ++i) {
+            const Unit& unit = *myUnits[i];
+            if (cancelled) {
+                return;
+            }
+            if (!nearestEnemies[i] || !unit.weapon ||
+                (unit.weapon->fireTimer && *(unit.weapon->fireTimer) > 1 / predicted.properties.ticksPerSecond)) {
+                continue;
+            }
+            speculation.hitProbabilities[{unit.id, nearestEnemies[i]->id}] =
+                calculateHitProbability(unit, *nearestEnemies[i], predicted, debug);
+        }
+    }
+
+    // The responses are cached by their key anyway, prepareTick drops them if the enemy moves differently
+    if (predicted.currentTick % 100 != 0) {
+        for (size_t i = 0; i < myUnits.size(); ++i) {
+            if (cancelled) {
+                return;
+            }
+            auto actionIt = actions.find(myUnits[i]->id);
+            getEnemyResponses(*myUnits[i], predicted, actionIt != actions.end() ? actionIt->second : UnitAction(), debug);
+        }
+    }
+    MyStrategy::addPerf("speculate", t1);
+}
+
+double MyStrategy::speculatePathDistance(const Vec2Double& src, const Vec2Double& dst, const Unit& unit,
+                                         const Game& game, Debug& debug) {
+    Vec2Double simSrcPosition;
+    double distance = calculatePathDistance(src, dst, unit, game, debug, simSrcPosition);
+    if (!isPathFilled[getPathsIndex(src)]) {
+        int dstIdx = getPathsIndex(dst);
+        if (!isPathFilled[dstIdx]) {
+            dstIdx = getPathsIndex(findNearestTile(dst));
+        }
+        speculation.pathDistances[{unit.id, dstIdx}] = SpeculativePath{src, unit.jumpState, distance, simSrcPosition};
+    }
+    return distance;
+}
+
+UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debug) {
+    if (tickContext.tick != game.currentTick) {
+        prepareTick(game, unit.playerId, debug);
     }
 
     auto suicideAction = doSuicide(unit, game, debug);
@@ -80,61 +443,26 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
 //        pathDrawLastTick = game.currentTick;
 //    }
 
-    if (simulation) {
-        simulation->game.currentTick = game.currentTick;
-        simulation->bullets = game.bullets;
-    } else {
-        simulation = std::make_shared<Simulation>(Simulation(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.5), true, true, false));
-    }
-    if (nextUnit) {
-//        if (!areSame(unit.position.x, nextUnit->position.x, 1e-2) || !areSame(unit.position.y, nextUnit->position.y, 1e-2)) {
-//            std::cerr << "Unit position x: " << unit.position.x << ", simulation pos x: " << nextUnit->position.x << '\n';
-//            std::cerr << "Unit position y: " << unit.position.y << ", simulation pos y: " << nextUnit->position.y << '\n';
-//            std::cerr << "Unit jumpState: " << unit.jumpState.toString() << ", simulation jumpState: " << nextUnit->jumpState.toString() << '\n';
-//        }
-//        if (unit.health != nextUnit->health) {
-//            std::cerr << "Unit health: " << unit.health << ", simulation health: " << nextUnit->health << '\n';
-//        }
-//        if (unit.weapon && nextUnit->weapon) {
-//            if (!areSame(unit.weapon->spread, nextUnit->weapon->spread, 1e-3) || !areSame(*(unit.weapon->fireTimer), *(nextUnit->weapon->fireTimer), 1e-9)) {
-//                std::cerr << "Unit spread: " << unit.weapon->spread << ", simulation spread: " << nextUnit->weapon->spread << '\n';
-//                std::cerr << "Unit fireTimer: " << *(unit.weapon->fireTimer) << ", simulation fireTimer: " << *(nextUnit->weapon->fireTimer) << '\n';
-//            }
-//        }
-    }
-
-    std::vector<const Unit*> myUnits;
-    std::vector<const Unit*> enemyUnits;
-    for (const Unit& other : game.units) {
-        if (other.playerId == unit.playerId) {
-            myUnits.push_back(&other);
-        } else {
-            enemyUnits.push_back(&other);
-        }
-    }
-
-    if (suicide.empty()) {
-        for (const Unit* myU : myUnits) {
-            suicide[myU->id] = false;
-        }
-    }
+    bool warmStart = matchesPlan(unit, game);
 
     const Unit* nearestEnemy = nullptr;
     double minDistance = 10000000.0;
-    for (const Unit* enemy : enemyUnits) {
+    for (const Unit& enemy : tickContext.enemyUnits) {
         Vec2Double simSrcPosition;
-        double distance = calculatePathDistance(unit.position, enemy->position, unit, game, debug, simSrcPosition);
+        double distance = calculatePathDistance(unit.position, enemy.position, unit, game, debug, simSrcPosition);
         if (distance < minDistance) {
             minDistance = distance;
-            nearestEnemy = enemy;
+            nearestEnemy = &enemy;
         }
     }
 
     double targetImportance;
     const auto& targetPos = findTargetPosition(unit, nearestEnemy, game, debug, targetImportance);
 
-    debug.draw(CustomData::Log(
-        std::string("Target pos: ") + targetPos.toString()));
+    if constexpr (Debug::ENABLED) {
+        debug.draw(CustomData::Log(
+            std::string("Target pos: ") + targetPos.toString()));
+    }
     Vec2Double aim = Vec2Double(0, 0);
     if (nearestEnemy != nullptr && unit.weapon) {
         aim = predictShootAngle2(unit, *nearestEnemy, game, debug);
@@ -147,13 +475,15 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
     action.swapWeapon = unit.weapon && unit.weapon->typ == ROCKET_LAUNCHER;
     action.plantMine = false;
 
-    debug.draw(CustomData::Log(
-        std::string("Unit pos: ") + unit.position.toString()));
-    debug.draw(CustomData::Log(
-        std::string("Jump state: ") + unit.jumpState.toString()));
-    if (unit.weapon) {
+    if constexpr (Debug::ENABLED) {
+        debug.draw(CustomData::Log(
+            std::string("Unit pos: ") + unit.position.toString()));
         debug.draw(CustomData::Log(
-            std::string("Weapon: ") + unit.weapon->toString()));
+            std::string("Jump state: ") + unit.jumpState.toString()));
+        if (unit.weapon) {
+            debug.draw(CustomData::Log(
+                std::string("Weapon: ") + unit.weapon->toString()));
+        }
     }
 
     std::unordered_map<int, Unit> units;
@@ -161,12 +491,9 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
         units[u.id] = u;
     }
 
-//    nextUnit = simulation->simulate(action, units, unit.id)[unit.id];
-//    prevAction = action;
-
     if (nearestEnemy != nullptr) {
         action.shoot = shouldShoot(unit, *nearestEnemy, aim, game, debug);
-        auto bestAction = avoidBullets(unit, nearestEnemy->id, game, targetPos, targetImportance, action, debug);
+        auto bestAction = avoidBullets(unit, nearestEnemy->id, game, targetPos, targetImportance, action, warmStart, debug);
         if (bestAction) {
             action.velocity = bestAction->velocity;
             action.jump = bestAction->jump;
@@ -174,7 +501,7 @@ UnitAction MyStrategy::getAction(const Unit& unit, const Game& game, Debug& debu
         }
     }
 
-    std::cerr << "ACTUAL ACTION: " << action.toString() << "\n";
+    LOG(DEBUG) << "ACTUAL ACTION: " << action.toString();
 
     return action;
 }
@@ -190,8 +517,8 @@ std::optional<UnitAction> MyStrategy::doSuicide(const Unit& unit, const Game& ga
     action.swapWeapon = false;
     action.plantMine = true;
 
-    if (suicide[unit.id]) {
-        suicide[unit.id] = false;
+    if (suicide.at(unit.id)) {
+        suicide.at(unit.id) = false;
         return action;
     }
 
@@ -274,7 +601,7 @@ std::optional<UnitAction> MyStrategy::doSuicide(const Unit& unit, const Game& ga
             if (enemyKilled2 == enemyUnitsCount && myKilled2 == myUnitsCount && myScore + enemyDamage <= enemyScore) {
                 return std::nullopt;
             }
-            suicide[unit.id] = true;
+            suicide.at(unit.id) = true;
             action.shoot = false;
             return action;
         }
@@ -288,8 +615,72 @@ std::optional<UnitAction> MyStrategy::doSuicide(const Unit& unit, const Game& ga
     return std::nullopt;
 }
 
+bool MyStrategy::matchesPlan(const Unit& unit, const Game& game) {
+    auto planIt = plans.find(unit.id);
+    if (planIt == plans.end() || planIt->second.tick != game.currentTick - 1 || planIt->second.trajectory.empty()) {
+        return false;
+    }
+    const Unit& nextUnit = planIt->second.trajectory[0];
+    if (!areSame(unit.position.x, nextUnit.position.x, 1e-2) || !areSame(unit.position.y, nextUnit.position.y, 1e-2)) {
+        LOG(DEBUG) << "Unit position x: " << unit.position.x << ", simulation pos x: " << nextUnit.position.x;
+        LOG(DEBUG) << "Unit position y: " << unit.position.y << ", simulation pos y: " << nextUnit.position.y;
+        return false;
+    }
+    if (unit.jumpState.canJump != nextUnit.jumpState.canJump || unit.jumpState.canCancel != nextUnit.jumpState.canCancel) {
+        LOG(DEBUG) << "Unit jumpState: " << unit.jumpState.toString() << ", simulation jumpState: " << nextUnit.jumpState.toString();
+        return false;
+    }
+    if (unit.health != nextUnit.health) {
+        LOG(DEBUG) << "Unit health: " << unit.health << ", simulation health: " << nextUnit.health;
+        return false;
+    }
+    return true;
+}
+
+AimMemo::AimMemo(const Unit& shooter, const Unit& target, const Vec2Double& aim)
+    : shooterPosition(shooter.position)
+    , weaponType(shooter.weapon->typ)
+    , lastAngle(*(shooter.weapon->lastAngle))
+    , spread(shooter.weapon->spread)
+    , fireTimer(shooter.weapon->fireTimer.value_or(-1.0))
+    , targetPosition(target.position)
+    , targetJumpState(target.jumpState)
+    , aim(aim) {
+}
+
+bool AimMemo::matches(const Unit& shooter, const Unit& target) const {
+    return shooterPosition.x == shooter.position.x && shooterPosition.y == shooter.position.y &&
+           weaponType == shooter.weapon->typ && lastAngle == *(shooter.weapon->lastAngle) &&
+           spread == shooter.weapon->spread && fireTimer == shooter.weapon->fireTimer.value_or(-1.0) &&
+           targetPosition.x == target.position.x && targetPosition.y == target.position.y &&
+           targetJumpState.canJump == target.jumpState.canJump && targetJumpState.speed == target.jumpState.speed &&
+           targetJumpState.maxTime == target.jumpState.maxTime && targetJumpState.canCancel == target.jumpState.canCancel;
+}
+
 Vec2Double MyStrategy::predictShootAngle2(const Unit& unit, const Unit& enemyUnit, const Game& game, Debug& debug, bool simulateFallDown) {
-    Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 1.0, 1.0, 0.3), true, false, false, 1);
+    if (aimMemoTable.planningPass != planningPass) {
+        if (aimMemoTable.hits + aimMemoTable.misses > 0) {
+            MyStrategy::addCounter("aimMemoHits", aimMemoTable.hits);
+            MyStrategy::addCounter("aimMemoMisses", aimMemoTable.misses);
+        }
+        aimMemoTable.planningPass = planningPass;
+        aimMemoTable.hits = 0;
+        aimMemoTable.misses = 0;
+        aimMemoTable.aims.clear();
+    }
+    AimKey key{unit.id, enemyUnit.id, game.currentTick, simulateFallDown};
+    auto it = aimMemoTable.aims.find(key);
+    if (it != aimMemoTable.aims.end() && it->second.matches(unit, enemyUnit)) {
+        ++aimMemoTable.hits;
+        return it->second.aim;
+    }
+    ++aimMemoTable.misses;
+    Vec2Double aim = calculateShootAngle(unit, enemyUnit, game, simulateFallDown);
+    aimMemoTable.aims.insert_or_assign(key, AimMemo(unit, enemyUnit, aim));
+    return aim;
+}
+
+Vec2Double MyStrategy::calculateShootAngle(const Unit& unit, const Unit& enemyUnit, const Game& game, bool simulateFallDown) {
     double lastAngle = *(unit.weapon->lastAngle);
 
     Vec2Double aim;
@@ -302,16 +693,16 @@ Vec2Double MyStrategy::predictShootAngle2(const Unit& unit, const Unit& enemyUni
     } else {
         double speed = unit.weapon->params.bullet.speed;
 
-        std::unordered_map<int, UnitAction> params;
         int simulationMaxTicks = 30;
-        const auto& actions = StrategyGenerator::getActions(simulationMaxTicks, 0, false, false);
+        // One microtick per tick like the Simulation this replaced, the aim doesn't need the exact landing point
+        KinematicPredictor predictor(enemyUnit, game, 1);
+        const auto standAction = StrategyGenerator::getAction(0, false, false);
 
         for (int ticks = 0; ticks < simulationMaxTicks; ++ticks) {
             double distSqr = distanceSqr(enemyPosition, unit.position);
             double bulletDist = speed * ticks / 60.0;
-            params[enemyUnit.id] = actions[ticks];
-            sim.simulate(params);
-            enemyPosition = sim.units[enemyUnit.id].position;
+            predictor.simulateTick(standAction);
+            enemyPosition = predictor.getPosition();
             if (distSqr < bulletDist * bulletDist) {
                 break;
             }
@@ -320,12 +711,14 @@ Vec2Double MyStrategy::predictShootAngle2(const Unit& unit, const Unit& enemyUni
     double xDiff = enemyPosition.x - unit.position.x;
     double yDiff = enemyPosition.y - unit.position.y;
 
-    std::vector<double> enemyUnitAngles = {
-        atan2(yDiff + unit.size.y / 2, xDiff + unit.size.x / 2),
-        atan2(yDiff + unit.size.y / 2, xDiff - unit.size.x / 2),
-        atan2(yDiff - unit.size.y / 2, xDiff + unit.size.x / 2),
-        atan2(yDiff - unit.size.y / 2, xDiff - unit.size.x / 2)
+    const std::array<double, 4> cornerYs = {
+        yDiff + unit.size.y / 2, yDiff + unit.size.y / 2, yDiff - unit.size.y / 2, yDiff - unit.size.y / 2
     };
+    const std::array<double, 4> cornerXs = {
+        xDiff + unit.size.x / 2, xDiff - unit.size.x / 2, xDiff + unit.size.x / 2, xDiff - unit.size.x / 2
+    };
+    std::array<double, 4> enemyUnitAngles;
+    fastAtan2(cornerYs.data(), cornerXs.data(), enemyUnitAngles.data(), enemyUnitAngles.size());
 
     double minEnemyAngle = enemyUnitAngles[0];
     double maxEnemyAngle = enemyUnitAngles[0];
@@ -364,13 +757,14 @@ Vec2Double MyStrategy::predictShootAngle2(const Unit& unit, const Unit& enemyUni
     aim = Vec2Double(enemyPosition.x - unit.position.x,
                      enemyPosition.y - unit.position.y);
     fastMoveAngle = !(unit.weapon->fireTimer && unit.weapon->fireTimer > 1. / 60);
-    if (findAngle(atan2(aim.y, aim.x), lastAngle) > unit.weapon->params.maxSpread * 1.2) {
-        targetAngle = atan2(aim.y, aim.x);
+    double aimAngle = fastAtan2(aim.y, aim.x);
+    if (findAngle(aimAngle, lastAngle) > unit.weapon->params.maxSpread * 1.2) {
+        targetAngle = aimAngle;
         fastMoveAngle = true;
     } else if (areSame(unit.weapon->spread, unit.weapon->params.minSpread)) {
-        targetAngle = atan2(aim.y, aim.x);
+        targetAngle = aimAngle;
     } else if (dontMove) {
-        return Vec2Double(cos(lastAngle), sin(lastAngle));
+        return unitVector(lastAngle);
     }
 
 //    double anglesAbs = fabs(targetAngle - lastAngle);
@@ -385,7 +779,7 @@ Vec2Double MyStrategy::predictShootAngle2(const Unit& unit, const Unit& enemyUni
         finalTargetAngle = lastAngle - step;
     }
 
-    return Vec2Double(cos(finalTargetAngle), sin(finalTargetAngle));
+    return unitVector(finalTargetAngle);
 }
 
 std::optional<UnitAction> MyStrategy::avoidBullets(const Unit& unit,
@@ -394,206 +788,435 @@ std::optional<UnitAction> MyStrategy::avoidBullets(const Unit& unit,
                                                    const Vec2Double& targetPos,
                                                    double targetImportance,
                                                    const UnitAction& targetAction,
+                                                   bool warmStart,
                                                    Debug& debug) {
-    std::cerr << "Current tick: " << game.currentTick << "\n";
-    std::cerr << "Current unit: " << unit.id << "\n";
-    std::cerr << "Target position: (" << targetPos.x << ", " << targetPos.y << ")\n";
+    auto startTime = std::chrono::high_resolution_clock::now();
+    LOG(DEBUG) << "Current tick: " << game.currentTick;
+    LOG(DEBUG) << "Current unit: " << unit.id;
+    LOG(DEBUG) << "Target position: (" << targetPos.x << ", " << targetPos.y << ")";
     int actionTicks = 45;
-    std::vector<std::vector<UnitAction>> actionSets;
-    if (!unit.jumpState.canJump && areSame(unit.jumpState.maxTime, 0.0)) {
-        actionSets = {
-            StrategyGenerator::getActions(actionTicks, 1, false, false),
-            StrategyGenerator::getActions(actionTicks, 0, false, false),
-            StrategyGenerator::getActions(actionTicks, -1, false, false),
-            StrategyGenerator::getActions(actionTicks, 1, false, true),
-            StrategyGenerator::getActions(actionTicks, 0, false, true),
-            StrategyGenerator::getActions(actionTicks, -1, false, true)
-        };
+    bool canJump = unit.jumpState.canJump || !areSame(unit.jumpState.maxTime, 0.0);
+    std::vector<ActionSequence> actionSets;
+    int enemyBulletsCount = 0;
+    for (const Bullet& bullet : game.bullets) {
+        if (bullet.playerId != unit.playerId) {
+            ++enemyBulletsCount;
+        }
+    }
+
+    bool quietTick = false;
+    if (warmStart) {
+        const Plan& plan = plans.at(unit.id);
+        ActionSequence shiftedActions = plan.actions.shifted();
+
+        // No new enemy bullets and no real hits predicted: the shifted plan is still a good incumbent
+        quietTick = plan.quiet && enemyBulletsCount <= plan.enemyBulletsCount;
+
+        if (quietTick || !shiftedActions.isConstant()) {
+            actionSets.push_back(shiftedActions);
+        }
+    }
+
+    if (quietTick) {
+        // Nothing threatens the plan: keep it and try only the neighbouring primitives of its first action
+        const UnitAction head = actionSets[0][0];
+        double move = head.velocity / 10;
+        for (double otherMove : {1.0, 0.0, -1.0}) {
+            if (!areSame(otherMove, move)) {
+                actionSets.emplace_back(ActionChain{actionTicks, otherMove, head.jump, head.jumpDown});
+            }
+        }
+        for (const auto& [jump, jumpDown] : {std::pair(true, false), std::pair(false, false), std::pair(false, true)}) {
+            if ((jump != head.jump || jumpDown != head.jumpDown) && (canJump || !jump)) {
+                actionSets.emplace_back(ActionChain{actionTicks, move, jump, jumpDown});
+            }
+        }
+        MyStrategy::addCounter("warmStartTicks");
     } else {
-        actionSets = {
-            StrategyGenerator::getActions(actionTicks, 1, true, false),
-            StrategyGenerator::getActions(actionTicks, 0, true, false),
-            StrategyGenerator::getActions(actionTicks, -1, true, false),
-            StrategyGenerator::getActions(actionTicks, 1, false, false),
-            StrategyGenerator::getActions(actionTicks, 0, false, false),
-            StrategyGenerator::getActions(actionTicks, -1, false, false),
-            StrategyGenerator::getActions(actionTicks, 1, false, true),
-            StrategyGenerator::getActions(actionTicks, 0, false, true),
-            StrategyGenerator::getActions(actionTicks, -1, false, true)
-        };
+        for (int i = StrategyGenerator::firstPrimitive(canJump); i < StrategyGenerator::PRIMITIVE_CHAINS.size(); ++i) {
+            actionSets.emplace_back(StrategyGenerator::PRIMITIVE_CHAINS[i].withCount(actionTicks));
+        }
     }
+    MyStrategy::addCounter("candidateSims", actionSets.size());
 
     std::optional<UnitAction> bestAction;
 //
-    std::vector<std::vector<UnitAction>> enemyActionSets;
-    std::vector<int> enemyUnitIds;
-    for (const Unit& u : game.units) {
-        if (u.playerId != unit.playerId) {
-            enemyUnitIds.push_back(u.id);
-            std::vector<UnitAction> actions = {
-                StrategyGenerator::getActions(1, 1, true, false)[0],
-                StrategyGenerator::getActions(1, -1, true, false)[0],
-                StrategyGenerator::getActions(1, 1, false, true)[0],
-                StrategyGenerator::getActions(1, -1, false, true)[0]
-            };
-            enemyActionSets.push_back(actions);
+    EnemyModel enemies = getEnemyResponses(unit, game, targetAction, debug);
+
+    bool useBeam = plannerConfig.beamWidth > 0 && !plannerConfig.beamBranchTicks.empty() && !quietTick;
+    int branchTick = useBeam ? plannerConfig.beamBranchTicks[0] : actionTicks;
+
+    std::vector<Candidate> candidates(actionSets.size());
+    auto evaluateCandidate = [&](int setIdx, const PruningBound* bound) {
+        Candidate& candidate = candidates[setIdx];
+        candidate.actions = actionSets[setIdx];
+        candidate.sim = std::make_shared<Simulation>(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 10);
+        candidate.sim->trackScore(unit, scoreMultiplier, plannerConfig.debugEvents);
+        candidate.targetDistance = 0.0;
+        simulateCandidate(candidate, 0, branchTick, unit, enemyUnitId, enemies, targetPos, bound, debug);
+        if (useBeam && !candidate.pruned) {
+            candidate.snapshot = std::make_shared<Simulation>(*candidate.sim);
+        }
+        simulateCandidate(candidate, branchTick, actionTicks, unit, enemyUnitId, enemies, targetPos, bound, debug);
+    };
+    // The first candidate (previous plan when warm starting) is the incumbent the others are pruned against
+    evaluateCandidate(0, nullptr);
+    PruningBound bound{candidates[0].sim->score.getScore(), candidates[0].targetDistance, targetImportance,
+                       maxScoreGain(unit, game, actionTicks)};
+    threadPool->parallelFor(int(actionSets.size()) - 1, [&](int setIdx) {
+        evaluateCandidate(setIdx + 1, &bound);
+    });
+
+    std::optional<Candidate> best;
+    for (const Candidate& candidate : candidates) {
+        if (candidate.pruned) {
+            continue;
+        }
+//        debug.draw(CustomData::Rect(
+//            Vec2Float(candidate.sim->units[unit.id].position.x - candidate.sim->units[unit.id].size.x / 2, candidate.sim->units[unit.id].position.y),
+//            Vec2Float(candidate.sim->units[unit.id].size.x, candidate.sim->units[unit.id].size.y),
+//            colors[colorIndex]
+//        ));
+
+        LOG(TRACE) << "Consider action: " << candidate.actions[0].toString();
+        for (const auto& event : candidate.sim->events) {
+            LOG(TRACE) << event.toString();
+        }
+        if (!best || compareSimulations(*candidate.sim, *best->sim, candidate.actions[0], best->actions[0],
+                                        candidate.targetDistance, best->targetDistance,
+                                        game, unit, actionTicks, targetPos, targetImportance, targetAction) > 0) {
+            best = candidate;
         }
     }
 
-    std::unordered_map<int, UnitAction> params;
+    LOG(DEBUG) << "========= FINISHED CHOOSE DIRECTION. Best action: " << best->actions[0].toString();
+
+    if (useBeam) {
+        beamSearch(candidates, best, unit, enemyUnitId, game, enemies, targetPos, targetImportance, targetAction,
+                   actionTicks, startTime + std::chrono::milliseconds(plannerConfig.planningBudgetMs), debug);
+    }
+
+    bool realHits = best->sim->score.hasRealHits();
+    plans.at(unit.id) = Plan{game.currentTick, best->actions, best->trajectory, enemyBulletsCount, !realHits};
+    bestAction = best->actions[0];
+
+//    if (noEvents) {
+//        return std::nullopt;
+//    }
+    if (bestAction) {
+        LOG(DEBUG) << "Best action: " << bestAction->toString();
+    }
+    return bestAction;
+}
 
-    std::vector<int> bestEnemyActionIndex = {0, 0};
+EnemyModel MyStrategy::getEnemyResponses(const Unit& unit, const Game& game, const UnitAction& targetAction, Debug& debug) {
+    int actionTicks = 45;
+    const std::array<UnitAction, 4> enemyActions = {
+        StrategyGenerator::getAction(1, true, false),
+        StrategyGenerator::getAction(-1, true, false),
+        StrategyGenerator::getAction(1, false, true),
+        StrategyGenerator::getAction(-1, false, true)
+    };
 
-    for (int enemyIdx = 0; enemyIdx < enemyUnitIds.size(); ++enemyIdx) {
-        int colorIndex = 0;
-        std::shared_ptr<Simulation> bestEnemySim = nullptr;
-        for (auto& actionSet : enemyActionSets[enemyIdx]) {
-            Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 3);
-            for (int i = 0; i < actionTicks; ++i) {
-                auto myAction = StrategyGenerator::getActions(1, 0, false, false)[0];
-                updateAction(sim.units, unit.id, enemyUnitIds[enemyIdx], myAction, game, debug);
-                updateAction(sim.units, enemyUnitIds[enemyIdx], unit.id, actionSet, game, debug);
-                params[unit.id] = myAction;
-                params[enemyUnitIds[enemyIdx]] = actionSet;
-                sim.simulate(params);
+    EnemyModel enemies;
+    std::vector<EnemyResponseKey> keys;
+    std::vector<int> missedEnemies;
+    {
+        std::lock_guard<std::mutex> lock(enemyResponsesMutex);
+        for (const Unit& u : game.units) {
+            if (u.playerId == unit.playerId) {
+                continue;
             }
-            if (bestEnemySim == nullptr || compareSimulations(sim, *bestEnemySim, actionSet, enemyActionSets[enemyIdx][bestEnemyActionIndex[enemyIdx]],
-                                                              0.0, 0.0, game,
-                                                              unit, actionTicks, unit.position, 0.0, targetAction) < 0) {
-                bestEnemySim = std::make_shared<Simulation>(sim);
-                bestEnemyActionIndex[enemyIdx] = colorIndex;
+            EnemyResponseKey key = getEnemyResponseKey(unit, u);
+            auto responseIt = enemyResponses.find(key);
+            if (responseIt != enemyResponses.end()) {
+                MyStrategy::addCounter("enemyResponseHits");
+            } else {
+                missedEnemies.push_back(enemies.unitIds.size());
             }
-            ++colorIndex;
+            enemies.unitIds.push_back(u.id);
+            enemies.actions.push_back(responseIt != enemyResponses.end() ? responseIt->second.action : enemyActions[0]);
+            keys.push_back(key);
         }
-
-        std::cerr << "=========Best enemy action: " << enemyActionSets[enemyIdx][bestEnemyActionIndex[enemyIdx]].toString() << '\n';
     }
+    if (missedEnemies.empty()) {
+        return enemies;
+    }
+    MyStrategy::addCounter("enemyResponseMisses", missedEnemies.size());
 
-    auto defaultAction = StrategyGenerator::getActions(1, 0, false, false)[0];
-    bool noEvents = true;
-    double bestTargetDistance = 0.0;
-    std::shared_ptr<Simulation> bestSim = nullptr;
-    for (auto& actionSet : actionSets) {
-        double targetDistance = 0.0;
-        Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 10);
+    std::vector<std::pair<int, int>> enemyCandidates;
+    for (int enemyIdx : missedEnemies) {
+        for (int actionIdx = 0; actionIdx < enemyActions.size(); ++actionIdx) {
+            enemyCandidates.emplace_back(enemyIdx, actionIdx);
+        }
+    }
+    std::vector<std::shared_ptr<Simulation>> enemySims(enemyCandidates.size());
+    std::vector<Vec2Double> predictedPositions(enemyCandidates.size());
+    threadPool->parallelFor(enemyCandidates.size(), [&](int candidateIdx) {
+        const auto& [enemyIdx, actionIdx] = enemyCandidates[candidateIdx];
+        int enemyUnitId = enemies.unitIds[enemyIdx];
+        auto actionSet = enemyActions[actionIdx];
+        auto sim = std::make_shared<Simulation>(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 3);
+        sim->trackScore(unit, scoreMultiplier, plannerConfig.debugEvents);
+        TickActions params;
         for (int i = 0; i < actionTicks; ++i) {
-            updateAction(sim.units, unit.id, enemyUnitId, actionSet[i], sim.game, debug);
-            params[unit.id] = actionSet[i];
-
-            for (int j = 0; j < enemyUnitIds.size(); ++j) {
-                if (i < 4) {
-                    updateAction(sim.units, enemyUnitIds[j], unit.id, enemyActionSets[j][bestEnemyActionIndex[j]], sim.game, debug);
-                    params[enemyUnitIds[j]] = enemyActionSets[j][bestEnemyActionIndex[j]];
-                } else {
-                    updateAction(sim.units, enemyUnitIds[j], unit.id, defaultAction, sim.game, debug);
-                    params[enemyUnitIds[j]] = defaultAction;
-                }
+            auto myAction = StrategyGenerator::getAction(0, false, false);
+            updateAction(sim->units, unit.id, enemyUnitId, myAction, game, debug);
+            updateAction(sim->units, enemyUnitId, unit.id, actionSet, game, debug);
+            params.set(unit.id, myAction);
+            params.set(enemyUnitId, actionSet);
+            sim->simulate(params);
+            if (i == 0) {
+                predictedPositions[candidateIdx] = sim->units[enemyUnitId].position;
             }
-
-            if (i == 6) {
-                Vec2Double simSrcPosition;
-                targetDistance = calculatePathDistance(sim.units[unit.id].position, targetPos, sim.units[unit.id], sim.game, debug, simSrcPosition);
-                if (getPathsIndex(simSrcPosition) == getPathsIndex(unit.position)) {
-                    targetDistance += 6;
-                }
+        }
+        enemySims[candidateIdx] = sim;
+    });
+
+    for (int missIdx = 0, candidateIdx = 0; missIdx < missedEnemies.size(); ++missIdx) {
+        int enemyIdx = missedEnemies[missIdx];
+        int bestActionIdx = 0;
+        int bestCandidateIdx = candidateIdx;
+        for (int actionIdx = 0; actionIdx < enemyActions.size(); ++actionIdx, ++candidateIdx) {
+            if (actionIdx > 0 && compareSimulations(*enemySims[candidateIdx], *enemySims[bestCandidateIdx],
+                                                    enemyActions[actionIdx], enemyActions[bestActionIdx],
+                                                    0.0, 0.0, game,
+                                                    unit, actionTicks, unit.position, 0.0, targetAction) < 0) {
+                bestActionIdx = actionIdx;
+                bestCandidateIdx = candidateIdx;
             }
-            int microticks = i < 20 ? 15 : 1;
-            sim.simulate(params, i < 3 ? 50 : microticks, true);
         }
+        enemies.actions[enemyIdx] = enemyActions[bestActionIdx];
+        LOG(DEBUG) << "=========Best enemy action: " << enemies.actions[enemyIdx].toString();
 
-//        debug.draw(CustomData::Rect(
-//            Vec2Float(sim.units[unit.id].position.x - sim.units[unit.id].size.x / 2, sim.units[unit.id].position.y),
-//            Vec2Float(sim.units[unit.id].size.x, sim.units[unit.id].size.y),
-//            colors[colorIndex]
-//        ));
+        std::lock_guard<std::mutex> lock(enemyResponsesMutex);
+        enemyResponses[keys[enemyIdx]] = EnemyResponse{enemies.actions[enemyIdx], predictedPositions[bestCandidateIdx]};
+    }
+    return enemies;
+}
 
-        std::cerr << "Consider action: " << actionSet[0].toString() << '\n';
-        for (const auto& event : sim.events) {
-            std::cerr << event.toString() << '\n';
+EnemyResponseKey MyStrategy::getEnemyResponseKey(const Unit& unit, const Unit& enemy) {
+    auto quantize = [](double value) { return int(std::floor(value / ENEMY_RESPONSE_PRECISION)); };
+    return EnemyResponseKey{
+        enemy.id,
+        quantize(enemy.position.x),
+        quantize(enemy.position.y),
+        quantize(unit.position.x - enemy.position.x),
+        quantize(unit.position.y - enemy.position.y),
+        enemy.jumpState.canJump,
+        unit.jumpState.canJump,
+        enemy.weapon ? int(enemy.weapon->typ) : -1,
+        unit.weapon ? int(unit.weapon->typ) : -1
+    };
+}
+
+void MyStrategy::invalidateEnemyResponses(const Game& game, int playerId) {
+    std::lock_guard<std::mutex> lock(enemyResponsesMutex);
+    for (const Unit& enemy : game.units) {
+        if (enemy.playerId == playerId) {
+            continue;
         }
-        if (bestSim == nullptr ||
-            compareSimulations(sim, *bestSim, actionSet[0], *bestAction, targetDistance, bestTargetDistance,
-                               game, unit, actionTicks, targetPos, targetImportance, targetAction) > 0) {
-            bestSim = std::make_shared<Simulation>(sim);
-            bestAction = actionSet[0];
-            bestTargetDistance = targetDistance;
+        // Responses of the enemy stay valid while it moves the way one of them predicted, up to the key precision
+        bool diverged = true;
+        for (const auto& [key, response] : enemyResponses) {
+            if (key.enemyId == enemy.id &&
+                areSame(response.predictedPosition.x, enemy.position.x, ENEMY_RESPONSE_PRECISION) &&
+                areSame(response.predictedPosition.y, enemy.position.y, ENEMY_RESPONSE_PRECISION)) {
+                diverged = false;
+                break;
+            }
+        }
+        if (diverged) {
+            for (auto it = enemyResponses.begin(); it != enemyResponses.end();) {
+                it = it->first.enemyId == enemy.id ? enemyResponses.erase(it) : std::next(it);
+            }
         }
+    }
+}
 
-        if (!sim.events.empty()) {
-            noEvents = false;
+void MyStrategy::simulateCandidate(Candidate& candidate, int fromTick, int toTick, const Unit& unit, int enemyUnitId,
+                                   const EnemyModel& enemies, const Vec2Double& targetPos, const PruningBound* bound,
+                                   Debug& debug) {
+    MyStrategy::addCounter("plannedTicks", toTick - fromTick);
+    if (candidate.pruned) {
+        MyStrategy::addCounter("prunedTicks", toTick - fromTick);
+        return;
+    }
+    Simulation& sim = *candidate.sim;
+    const auto defaultAction = StrategyGenerator::getAction(0, false, false);
+    TickActions params;
+    for (int i = fromTick; i < toTick; ++i) {
+        auto myAction = candidate.actions[i];
+        updateAction(sim.units, unit.id, enemyUnitId, myAction, sim.game, debug);
+        params.set(unit.id, myAction);
+
+        for (int j = 0; j < enemies.unitIds.size(); ++j) {
+            auto enemyAction = i < 4 ? enemies.actions[j] : defaultAction;
+            updateAction(sim.units, enemies.unitIds[j], unit.id, enemyAction, sim.game, debug);
+            params.set(enemies.unitIds[j], enemyAction);
+        }
+
+        for (const auto& [teammateId, teammateActions] : tickContext.teamPlans) {
+            if (teammateId != unit.id && sim.units.count(teammateId)) {
+                auto teammateAction = teammateActions[i];
+                teammateAction.shoot = false;
+                params.set(teammateId, teammateAction);
+            }
+        }
+
+        if (i == 6) {
+            Vec2Double simSrcPosition;
+            candidate.targetDistance = calculatePathDistance(sim.units[unit.id].position, targetPos, sim.units[unit.id], sim.game, debug, simSrcPosition);
+            if (getPathsIndex(simSrcPosition) == getPathsIndex(unit.position)) {
+                candidate.targetDistance += 6;
+            }
+        }
+        int microticks = i < 20 ? 15 : 1;
+        sim.simulate(params, i < 3 ? 50 : microticks, true);
+        candidate.trajectory.push_back(sim.units[unit.id]);
+
+        if (bound != nullptr && i + 1 < toTick && !canBeat(candidate, *bound, i)) {
+            candidate.pruned = true;
+            MyStrategy::addCounter("prunedTicks", toTick - i - 1);
+            return;
         }
     }
+}
 
-    std::cerr << "========= FINISHED CHOOSE DIRECTION. Best action: " << bestAction->toString() << "\n";
+bool MyStrategy::canBeat(const Candidate& candidate, const PruningBound& bound, int tick) {
+    // Events of the next simulate calls are at least tick + 2 ticks away from the start
+    double optimisticScore = candidate.sim->score.getScore() + ScoreAccumulator::discount(tick + 2) * bound.maxGain;
+    double targetDistance = candidate.targetDistance;
+    if (tick < 6) {
+        // Path distance isn't calculated yet, at best the candidate ends up right at the target
+        if (bound.targetImportance < 0) {
+            return true;
+        }
+        targetDistance = 0.0;
+    }
+    double distDiffScore = (targetDistance - bound.incumbentTargetDistance) / 6 * bound.targetImportance;
+    return optimisticScore - distDiffScore > bound.incumbentScore;
+}
 
-//    int firstChainActionTicks = 2;
-//
-//    const auto& tailChainActions = StrategyGenerator::getActions(
-//        actionTicks - firstChainActionTicks,
-//        bestAction->velocity / 10,
-//        bestAction->jump,
-//        bestAction->jumpDown
-//    );
-//
-//    std::vector<std::vector<UnitAction>> chainedActionSets = {
-//        StrategyGenerator::getActions(firstChainActionTicks, 1, true, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, 0, true, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, -1, true, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, 1, false, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, 0, false, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, -1, false, false, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, 1, false, true, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, 0, false, true, tailChainActions),
-//        StrategyGenerator::getActions(firstChainActionTicks, -1, false, true, tailChainActions)
-//    };
-//
-//    for (auto& actionSet : chainedActionSets) {
-//        double targetDistance = 0.0;
-//        Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 10);
-//        for (int i = 0; i < actionTicks; ++i) {
-//            updateAction(sim.units, unit.id, actionSet[i], sim.game, debug);
-//            params[unit.id] = actionSet[i];
-//
-//            for (int j = 0; j < enemyUnitIds.size(); ++j) {
-//                if (i < 3) {
-//                    updateAction(sim.units, enemyUnitIds[j], enemyActionSets[j][bestEnemyActionIndex[j]], sim.game, debug);
-//                    params[enemyUnitIds[j]] = enemyActionSets[j][bestEnemyActionIndex[j]];
-//                } else {
-//                    updateAction(sim.units, enemyUnitIds[j], defaultAction, sim.game, debug);
-//                    params[enemyUnitIds[j]] = defaultAction;
-//                }
-//            }
-//            int microticks = i < 20 ? 5 : 1;
-//            sim.simulate(params, i == 0 ? 50 : microticks);
-//            if (i == 10) {
-//                targetDistance = calculatePathDistance(sim.units[unit.id].position, targetPos, sim.units[unit.id], sim.game, debug);
-//            }
-//        }
-//
-//        std::cerr << "Consider action (chained): " << actionSet[0].toString() << '\n';
-//        for (const auto& event : sim.events) {
-//            std::cerr << event.toString() << '\n';
-//        }
-//        if (bestSim == nullptr || compareSimulations(sim, *bestSim, actionSet[0], *bestAction, targetDistance, bestTargetDistance, game,
-//                                                     unit, actionTicks, targetPos, 0.3, tailChainActions[0]) > 0) {
-//            bestSim = std::make_shared<Simulation>(sim);
-//            bestAction = actionSet[0];
-//            bestTargetDistance = targetDistance;
-//        }
-//
-//        if (!sim.events.empty()) {
-//            noEvents = false;
-//        }
-//    }
+double MyStrategy::maxScoreGain(const Unit& unit, const Game& game, int actionTicks) {
+    if (scoreMultiplier >= 0) {
+        // Damage to my unit is a gain too, no useful bound
+        return std::numeric_limits<double>::infinity();
+    }
+    int enemiesCount = 0;
+    for (const Unit& u : game.units) {
+        if (u.playerId != unit.playerId) {
+            ++enemiesCount;
+        }
+    }
+    double gain = 0.0;
+    for (const Bullet& bullet : game.bullets) {
+        gain += bullet.damage;
+        if (bullet.explosionParams) {
+            gain += bullet.explosionParams->damage * enemiesCount;
+        }
+    }
+    // Only my unit and the enemies act in the planner simulations. My bullets can hit an enemy directly,
+    // the enemy bullets can hurt the enemies only by explosions
+    for (const Unit& u : game.units) {
+        if (!u.weapon || (u.playerId == unit.playerId && u.id != unit.id)) {
+            continue;
+        }
+        const WeaponParams& params = u.weapon->params;
+        int shots = int(actionTicks / (params.fireRate * game.properties.ticksPerSecond)) + 1;
+        double shotGain = u.id == unit.id ? params.bullet.damage : 0.0;
+        if (params.explosion) {
+            shotGain += params.explosion->damage * enemiesCount;
+        }
+        gain += shots * shotGain;
+    }
+    // Teammates follow their plans in the simulations and can blow up their mines as well
+    for (const Unit& u : game.units) {
+        if (u.playerId == unit.playerId && u.mines > 0) {
+            gain += 100.0 * enemiesCount;
+        }
+    }
+    return gain;
+}
 
+void MyStrategy::beamSearch(std::vector<Candidate> beam,
+                            std::optional<Candidate>& best,
+                            const Unit& unit,
+                            int enemyUnitId,
+                            const Game& game,
+                            const EnemyModel& enemies,
+                            const Vec2Double& targetPos,
+                            double targetImportance,
+                            const UnitAction& targetAction,
+                            int actionTicks,
+                            std::chrono::high_resolution_clock::time_point deadline,
+                            Debug& debug) {
+    auto isBetter = [&](const Candidate& a, const Candidate& b) {
+        return compareSimulations(*a.sim, *b.sim, a.actions[0], b.actions[0], a.targetDistance, b.targetDistance,
+                                  game, unit, actionTicks, targetPos, targetImportance, targetAction) > 0;
+    };
+    bool canJump = unit.jumpState.canJump || !areSame(unit.jumpState.maxTime, 0.0);
+    const auto& branchTicks = plannerConfig.beamBranchTicks;
+
+    for (int level = 0; level < branchTicks.size(); ++level) {
+        // The budget is only checked between levels, a started level simulates all its children whatever the number
+        // of threads and the load of the machine
+        if (std::chrono::high_resolution_clock::now() > deadline) {
+            MyStrategy::addCounter("beamTimeouts");
+            break;
+        }
+        int branchTick = branchTicks[level];
+        int nextBranchTick = level + 1 < branchTicks.size() ? branchTicks[level + 1] : actionTicks;
+
+        // Candidates pruned before the branch tick have no snapshot to continue from, the rest of the pruned ones
+        // are known to lose to the best candidate and go after the fully simulated ones
+        beam.erase(std::remove_if(beam.begin(), beam.end(), [](const Candidate& node) { return node.snapshot == nullptr; }),
+                   beam.end());
+        auto prunedBegin = std::stable_partition(beam.begin(), beam.end(), [](const Candidate& node) { return !node.pruned; });
+        std::stable_sort(beam.begin(), prunedBegin, isBetter);
+        if (beam.size() > plannerConfig.beamWidth) {
+            beam.resize(plannerConfig.beamWidth);
+        }
 
-//    if (noEvents) {
-//        return std::nullopt;
-//    }
-    if (bestAction) {
-        std::cerr << "Best action: " << bestAction->toString() << "\n";
+        // Every node keeps its prefix up to branchTick and switches to another primitive for the rest of the horizon
+        std::vector<Candidate> children;
+        for (const Candidate& node : beam) {
+            const ActionChain& continuation = node.actions.chainAt(branchTick);
+            for (int i = StrategyGenerator::firstPrimitive(canJump); i < StrategyGenerator::PRIMITIVE_CHAINS.size(); ++i) {
+                const ActionChain& chain = StrategyGenerator::PRIMITIVE_CHAINS[i];
+                if (continuation.sameAction(chain)) {
+                    continue;
+                }
+                Candidate child;
+                child.actions = node.actions.prefix(branchTick).then(chain.withCount(actionTicks - branchTick));
+                child.snapshot = node.snapshot;
+                child.trajectory.assign(node.trajectory.begin(), node.trajectory.begin() + branchTick);
+                child.targetDistance = node.targetDistance;
+                children.push_back(child);
+            }
+        }
+        MyStrategy::addCounter("beamSims", children.size());
+
+        PruningBound bound{best->sim->score.getScore(), best->targetDistance, targetImportance,
+                           maxScoreGain(unit, game, actionTicks)};
+        threadPool->parallelFor(children.size(), [&](int childIdx) {
+            Candidate& child = children[childIdx];
+            child.sim = std::make_shared<Simulation>(*child.snapshot);
+            simulateCandidate(child, branchTick, nextBranchTick, unit, enemyUnitId, enemies, targetPos, &bound, debug);
+            child.snapshot = nextBranchTick < actionTicks && !child.pruned ? std::make_shared<Simulation>(*child.sim) : nullptr;
+            simulateCandidate(child, nextBranchTick, actionTicks, unit, enemyUnitId, enemies, targetPos, &bound, debug);
+        });
+
+        beam.clear();
+        for (const Candidate& child : children) {
+            LOG(TRACE) << "Consider action (chained at " << branchTick << "): " << child.actions[0].toString()
+                       << " -> " << child.actions[branchTick].toString();
+            if (!child.pruned && isBetter(child, *best)) {
+                best = child;
+            }
+            beam.push_back(child);
+        }
     }
-    return bestAction;
 }
 
 bool MyStrategy::shouldShoot(Unit unit, const Unit& enemyUnit, Vec2Double aim, const Game& game, Debug& debug) {
@@ -604,18 +1227,36 @@ bool MyStrategy::shouldShoot(Unit unit, const Unit& enemyUnit, Vec2Double aim, c
         return false;
     }
 
-    auto hitProbabilities = calculateHitProbability(unit, enemyUnit, game, debug);
+    // Walls cover every enemy, no bullet of the fan can hit any of them. The target may move by a tile while the
+    // bullet flies and an explosion reaches its radius past the wall the bullet hits.
+    Vec2Double muzzle(unit.position.x, unit.position.y + unit.size.y / 2);
+    const WeaponParams& weaponParams = unit.weapon->params;
+    double margin = weaponParams.bullet.size / 2 + 1.0 + (weaponParams.explosion ? weaponParams.explosion->radius : 0.0);
+    bool enemyVisible = false;
     for (const Unit& u : game.units) {
-        std::cerr << "unit id: " << u.id << ", hit probability: " << hitProbabilities[u.id] << '\n';
+        if (u.playerId != unit.playerId && visibility.isUnitVisible(muzzle, u, margin)) {
+            enemyVisible = true;
+            break;
+        }
+    }
+    if (!enemyVisible) {
+        MyStrategy::addCounter("occludedShots");
+        return false;
+    }
+
+    const auto& hitProbabilities = calculateHitProbability(unit, enemyUnit, game, debug);
+    for (int i = 0; i < game.units.size(); ++i) {
+        const Unit& u = game.units[i];
+        LOG(TRACE) << "unit id: " << u.id << ", hit probability: " << hitProbabilities[i];
         if (u.playerId == unit.playerId) {
-            if (hitProbabilities[u.id] > 0.09) {
+            if (hitProbabilities[i] > 0.09) {
                 return false;
             }
         } else {
-            if (unit.weapon->typ == ASSAULT_RIFLE && hitProbabilities[u.id] > 0.0) {
+            if (unit.weapon->typ == ASSAULT_RIFLE && hitProbabilities[i] > 0.0) {
                 return true;
             }
-            if (unit.weapon->typ != ASSAULT_RIFLE && hitProbabilities[u.id] > 0.0) {
+            if (unit.weapon->typ != ASSAULT_RIFLE && hitProbabilities[i] > 0.0) {
                 return true;
             }
         }
@@ -629,91 +1270,14 @@ int MyStrategy::compareSimulations(const Simulation& sim1, const Simulation& sim
                                    const Game& game, const Unit& unit, int actionTicks,
                                    const Vec2Double& targetPos, double targetImportance,
                                    const UnitAction& targetAction) {
-    int unitId = unit.id;
-    int indexSim1 = 0;
-    int indexSim2 = 0;
+    double score1 = sim1.score.getScore();
+    LOG(TRACE) << "score: " << score1;
 
-    auto events1 = sim1.events;
-    auto events2 = sim2.events;
-
-//    while (indexSim1 < events1.size() && indexSim2 < events2.size()) {
-//        if (events1[indexSim1].tick > events2[indexSim2].tick) {
-//            if (events1[indexSim1].tick - events2[indexSim2].tick == 1) {
-//                events1[indexSim1].tick = events2[indexSim2].tick;
-//            }
-//            ++indexSim1;
-//        } else {
-//            if (events2[indexSim2].tick - events1[indexSim1].tick == 1) {
-//                events2[indexSim2].tick = events1[indexSim1].tick;
-//            }
-//            ++indexSim2;
-//        }
-//    }
-
-    double score1 = 0.0;
-    for (const auto& event : events1) {
-        double timeMultiplier = 1.0;
-        for (int i = 0; i < event.tick; ++i) {
-            timeMultiplier *= 0.9;
-        }
-        double eventScore = event.damage * timeMultiplier;
-
-        if (eventScore < 0 && event.unitId == unit.id) {
-            eventScore = -std::min(100 - unit.health, 50.0);
-        } else if (!event.real) {
-            double prob = event.probability;
-//            for (int i = 0; i < event.shootTick; ++i) {
-//                if (event.damage == 30 || event.damage == 50) {
-//                    prob *= 0.85;
-//                } else {
-//                    prob *= 0.93;
-//                }
-//            }
-            eventScore *= std::min(prob, 1.0);
-        }
-        if (event.unitId == unitId) {
-            eventScore = scoreMultiplier * eventScore;
-        } else if (sim1.units.at(event.unitId).playerId == unit.playerId) {
-            eventScore = 0;
-        }
-        score1 += eventScore;
-    }
-
-    std::cerr << "score: " << score1 << '\n';
-
-    double score2 = 0.0;
-    for (const auto& event : events2) {
-        double timeMultiplier = 1.0;
-        for (int i = 0; i < event.tick; ++i) {
-            timeMultiplier *= 0.9;
-        }
-        double eventScore = event.damage * timeMultiplier;
-
-        if (eventScore < 0 && event.unitId == unit.id) {
-            eventScore = -std::min(100 - unit.health, 50.0);
-        } else if (!event.real) {
-            double prob = event.probability;
-//            for (int i = 0; i < event.shootTick; ++i) {
-//                if (event.damage == 30 || event.damage == 50) {
-//                    prob *= 0.85;
-//                } else {
-//                    prob *= 0.93;
-//                }
-//            }
-            eventScore *= std::min(prob, 1.0);
-        }
-        if (event.unitId == unitId) {
-            eventScore = scoreMultiplier * eventScore;
-        } else if (sim2.units.at(event.unitId).playerId == unit.playerId) {
-            eventScore = 0;
-        }
-        score2 += eventScore;
-    }
-
-    std::cerr << "best score: " << score2 << '\n';
+    double score2 = sim2.score.getScore();
+    LOG(TRACE) << "best score: " << score2;
 
     double distDiffScore = (targetDistance1 - targetDistance2) / 6 * targetImportance;
-    std::cerr << "Dist diff score: " << distDiffScore << '\n';
+    LOG(TRACE) << "Dist diff score: " << distDiffScore;
 //    if (!areSame(score1, score2, targetImportance)) {
     if (score1 - distDiffScore > score2) {
         return 1;
@@ -723,42 +1287,16 @@ int MyStrategy::compareSimulations(const Simulation& sim1, const Simulation& sim
 }
 
 void MyStrategy::buildPathGraph(const Unit& unit, const Game& game, Debug& debug) {
-    std::vector<std::vector<UnitAction>> actions = {
-        StrategyGenerator::getActions(1, 1, true, false),
-        StrategyGenerator::getActions(1, 0.5, true, false),
-        StrategyGenerator::getActions(1, 0.25, true, false),
-        StrategyGenerator::getActions(1, 0.1, true, false),
-        StrategyGenerator::getActions(1, 0, true, false),
-        StrategyGenerator::getActions(1, -0.1, true, false),
-        StrategyGenerator::getActions(1, -0.25, true, false),
-        StrategyGenerator::getActions(1, -0.5, true, false),
-        StrategyGenerator::getActions(1, -1, true, false),
-        StrategyGenerator::getActions(1, 1, false, true),
-        StrategyGenerator::getActions(1, 0.25, false, true),
-        StrategyGenerator::getActions(1, 0.1, false, true),
-        StrategyGenerator::getActions(1, 0, false, true),
-        StrategyGenerator::getActions(1, -0.1, false, true),
-        StrategyGenerator::getActions(1, -0.25, false, true),
-        StrategyGenerator::getActions(1, -1, false, true),
-        StrategyGenerator::getActions(1, 1, false, false),
-        StrategyGenerator::getActions(1, -1, false, false),
-        StrategyGenerator::getActions(6, 1, false, true, StrategyGenerator::getActions(1, 0, false, true)),
-        StrategyGenerator::getActions(6, -1, false, true, StrategyGenerator::getActions(1, 0, false, true)),
-        StrategyGenerator::getActions(9, 1, true, false, StrategyGenerator::getActions(9, 1, false, true)),
-        StrategyGenerator::getActions(9, -1, true, false, StrategyGenerator::getActions(9, -1, false, true)),
-        StrategyGenerator::getActions(6, 0, true, false, StrategyGenerator::getActions(3, 1, true, false, StrategyGenerator::getActions(9, 1, false, true))),
-        StrategyGenerator::getActions(6, 0, true, false, StrategyGenerator::getActions(3, -1, true, false, StrategyGenerator::getActions(9, -1, false, true)))
-    };
-    pathDfs(int(unit.position.x), int(unit.position.y), actions, unit, game, debug);
+    pathDfs(int(unit.position.x), int(unit.position.y), unit, game, debug);
 }
 
-void MyStrategy::pathDfs(int x, int y, const std::vector<std::vector<UnitAction>>& actions, const Unit& unit, const Game& game, Debug& debug) {
+void MyStrategy::pathDfs(int x, int y, const Unit& unit, const Game& game, Debug& debug) {
     Vec2Double pos(x, y);
     if (isPathFilled[getPathsIndex(pos)]) {
         return;
     }
     isPathFilled[getPathsIndex(pos)] = true;
-    for (const auto& action : actions) {
+    for (const ActionSequence& action : StrategyGenerator::PATH_GRAPH_SEQUENCES) {
         Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 1.0, 1.0, 0.3), true, false, false, 1);
         sim.units[unit.id].position.x = x + 0.5;
         sim.units[unit.id].position.y = y;
@@ -771,9 +1309,9 @@ void MyStrategy::pathDfs(int x, int y, const std::vector<std::vector<UnitAction>
         }
         sim.units = units;
 
-        std::unordered_map<int, UnitAction> params;
+        TickActions params;
         for (int tick = 1; tick < 200; ++tick) {
-            params[unit.id] = tick < action.size() ? action[tick] : action[action.size() - 1];
+            params.set(unit.id, action[tick]);
             sim.simulate(params);
             Vec2Double simPosition = sim.units[unit.id].position;
             if ((simPosition.y - int(simPosition.y) < game.properties.unitFallSpeed / 60 + 1e-5 ||
@@ -790,7 +1328,7 @@ void MyStrategy::pathDfs(int x, int y, const std::vector<std::vector<UnitAction>
                     int simPosIdx = getPathsIndex(simPosition);
                     if (tick + std::round(restTime) < paths[posIdx][simPosIdx]) {
                         paths[posIdx][simPosIdx] = tick + std::round(restTime);
-                        pathDfs(int(simPosition.x), int(simPosition.y), actions, unit, game, debug);
+                        pathDfs(int(simPosition.x), int(simPosition.y), unit, game, debug);
                     }
                     break;
                 }
@@ -807,7 +1345,7 @@ void MyStrategy::floydWarshall() {
         if (!isPathFilled[k]) {
             continue;
         }
-        std::cerr << k << ' ';
+        LOG(TRACE) << "floydWarshall k: " << k;
         for (int i = 0; i < 1200; ++i) {
             if (isPathFilled[i]) {
                 for (int j = 0; j < 1200; ++j) {
@@ -828,13 +1366,50 @@ Vec2Double MyStrategy::fromPathsIndex(int idx) {
     return Vec2Double(idx % 40 + 0.5, idx / 40);
 }
 
-Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestEnemy, const Game& game, Debug& debug, double& targetImportance) {
-    if (unitTargetWeapons.find(unit.id) == unitTargetWeapons.end()) {
-        unitTargetWeapons[unit.id] = std::nullopt;
+void MyStrategy::assignTargetWeapons(const Game& game, int playerId, Debug& debug) {
+    std::vector<LootBox> weapons;
+    for (const LootBox& lootBox : game.lootBoxes) {
+        if (std::dynamic_pointer_cast<Item::Weapon>(lootBox.item)) {
+            weapons.push_back(lootBox);
+        }
+    }
+
+    for (const Unit& u : game.units) {
+        if (u.playerId != playerId) {
+            continue;
+        }
+        if (u.weapon && u.weapon->typ != ROCKET_LAUNCHER) {
+            unitTargetWeapons[u.id] = std::nullopt;
+            continue;
+        }
+        double minDistance = 10000.0;
+        for (const auto& weapon : weapons) {
+            if (std::dynamic_pointer_cast<Item::Weapon>(weapon.item)->weaponType == ROCKET_LAUNCHER) {
+                continue;
+            }
+            bool skip = false;
+            for (const auto&[uid, targetWeapon] : unitTargetWeapons) {
+                if (targetWeapon && areSame(targetWeapon->position.x, weapon.position.x) &&
+                    areSame(targetWeapon->position.y, weapon.position.y) && uid != u.id) {
+                    skip = true;
+                }
+            }
+            if (skip) {
+                continue;
+            }
+
+            Vec2Double simSrcPosition;
+            double distance = calculatePathDistance(u.position, weapon.position, u, game, debug, simSrcPosition);
+            if (distance < minDistance) {
+                minDistance = distance;
+                unitTargetWeapons[u.id] = weapon;
+            }
+        }
     }
+}
 
+Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestEnemy, const Game& game, Debug& debug, double& targetImportance) {
     std::vector<LootBox> healthPacks;
-    std::vector<LootBox> weapons;
     std::vector<LootBox> mines;
     std::vector<double> myHPDistance;
     std::vector<double> enemyHPDistance;
@@ -846,52 +1421,15 @@ Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestE
             healthPacks.push_back(lootBox);
             myHPDistance.push_back(myDistance);
             enemyHPDistance.push_back(enemyDistance);
-        } else if (std::dynamic_pointer_cast<Item::Weapon>(lootBox.item)) {
-            weapons.push_back(lootBox);
         } else if (std::dynamic_pointer_cast<Item::Mine>(lootBox.item)) {
             mines.push_back(lootBox);
         }
     }
 
-    if (game.currentTick % 10 == 0) {
-        for (const Unit& u : game.units) {
-            if (u.playerId != unit.playerId) {
-                continue;
-            }
-            if (u.weapon && u.weapon->typ != ROCKET_LAUNCHER) {
-                unitTargetWeapons[u.id] = std::nullopt;
-                continue;
-            }
-            double minDistance = 10000.0;
-            for (const auto& weapon : weapons) {
-                if (std::dynamic_pointer_cast<Item::Weapon>(weapon.item)->weaponType == ROCKET_LAUNCHER) {
-                    continue;
-                }
-                bool skip = false;
-                for (const auto&[uid, targetWeapon] : unitTargetWeapons) {
-                    if (targetWeapon && areSame(targetWeapon->position.x, weapon.position.x) &&
-                        areSame(targetWeapon->position.y, weapon.position.y) && uid != u.id) {
-                        skip = true;
-                    }
-                }
-                if (skip) {
-                    continue;
-                }
-
-                Vec2Double simSrcPosition;
-                double distance = calculatePathDistance(u.position, weapon.position, u, game, debug, simSrcPosition);
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    unitTargetWeapons[u.id] = weapon;
-                }
-            }
-        }
-    }
-
     Vec2Double targetPos = unit.position;
     targetImportance = 0.2;
     if (!unit.weapon || unit.weapon->typ == ROCKET_LAUNCHER) {
-        targetPos = unitTargetWeapons[unit.id]->position;
+        targetPos = unitTargetWeapons.at(unit.id)->position;
         targetImportance = 100.0;
     } else if (!mines.empty() && unit.mines < 2) {
         const LootBox* bestMine = nullptr;
@@ -910,14 +1448,14 @@ Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestE
         LootBox* bestHealthPack = nullptr;
         double minDistance = 10000.0;
         for (int i = 0; i < healthPacks.size(); ++i) {
-            std::cerr << "Iteration " << i << ", myHPDistance: " << myHPDistance[i] << '\n';
-            std::cerr << "Iteration " << i << ", enemyHPDistance: " << enemyHPDistance[i] << '\n';
+            LOG(DEBUG) << "Iteration " << i << ", myHPDistance: " << myHPDistance[i];
+            LOG(DEBUG) << "Iteration " << i << ", enemyHPDistance: " << enemyHPDistance[i];
             if (myHPDistance[i] < enemyHPDistance[i] && myHPDistance[i] < minDistance) {
                 minDistance = myHPDistance[i];
                 bestHealthPack = &healthPacks[i];
             }
         }
-        std::cerr << "min distance: " << minDistance << '\n';
+        LOG(DEBUG) << "min distance: " << minDistance;
         double minDistanceDiff = 10000.0;
         if (bestHealthPack == nullptr) {
             for (int i = 0; i < healthPacks.size(); ++i) {
@@ -929,7 +1467,7 @@ Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestE
             }
         }
 
-        std::cerr << "min distance diff: " << minDistance << '\n';
+        LOG(DEBUG) << "min distance diff: " << minDistance;
 
         targetPos = bestHealthPack->position;
         targetImportance = 2.0;
@@ -955,7 +1493,7 @@ Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestE
                 }
 //                sum += paths[key][getPathsIndex(healthPacks[i].position)];
             }
-            sum = distanceSqr(fromPathsIndex(key), nearestEnemy->position);
+            sum = distanceSqr(fromPathsIndex(key), nearestEnemy->position) + plannerConfig.exposureCost * exposure.getExposure(key);
             if (winHealthPackPathNum > bestWinHealthPackPathNum ||
                 (winHealthPackPathNum == bestWinHealthPackPathNum && sum < minHealthPackDistanceSum)) {
                 bestWinHealthPackPathNum = winHealthPackPathNum;
@@ -964,19 +1502,38 @@ Vec2Double MyStrategy::findTargetPosition(const Unit& unit, const Unit* nearestE
             }
         }
         targetPos = fromPathsIndex(bestTileIndex);
-        std::cerr << "Best win healthpacks num: " << bestWinHealthPackPathNum << '\n';
-        std::cerr << "Target position from paths: " << targetPos.toString() << '\n';
+        LOG(DEBUG) << "Best win healthpacks num: " << bestWinHealthPackPathNum;
+        LOG(DEBUG) << "Target position from paths: " << targetPos.toString();
     } else if (nearestEnemy != nullptr) {
+        // Approach the enemy from far away, retreat to the far upper corner from close by, to a covered tile either way
         double desiredDistance = (nearestEnemy->weapon && nearestEnemy->weapon->typ == ROCKET_LAUNCHER) ? 81.0 : 16.0;
         if (distanceSqr(unit.position, nearestEnemy->position) > desiredDistance) {
-            targetPos = Vec2Double(nearestEnemy->position.x, nearestEnemy->position.y + nearestEnemy->size.y / 2);
+            targetPos = findCoveredTile(Vec2Double(nearestEnemy->position.x, nearestEnemy->position.y + nearestEnemy->size.y / 2),
+                                        nearestEnemy->position, desiredDistance);
         } else {
-            targetPos = unit.position.x > nearestEnemy->position.x ? Vec2Double(50.0, 50.0) : Vec2Double(0.0, 50.0);
+            targetPos = findCoveredTile(unit.position.x > nearestEnemy->position.x ? Vec2Double(50.0, 50.0) : Vec2Double(0.0, 50.0),
+                                        nearestEnemy->position, desiredDistance);
         }
     }
     return targetPos;
 }
 
+Vec2Double MyStrategy::findCoveredTile(const Vec2Double& point, const Vec2Double& enemyPosition, double minDistanceSqr) {
+    int bestTileIndex = -1;
+    double minCost = std::numeric_limits<double>::max();
+    for (int key = 0; key < 1200; ++key) {
+        if (!isPathFilled[key] || distanceSqr(fromPathsIndex(key), enemyPosition) < minDistanceSqr) {
+            continue;
+        }
+        double cost = distanceSqr(fromPathsIndex(key), point) + plannerConfig.exposureCost * exposure.getExposure(key);
+        if (cost < minCost) {
+            minCost = cost;
+            bestTileIndex = key;
+        }
+    }
+    return bestTileIndex == -1 ? point : fromPathsIndex(bestTileIndex);
+}
+
 Vec2Double MyStrategy::findNearestTile(const Vec2Double& tile) {
     int x = int(tile.x);
     int y = int(tile.y);
@@ -989,7 +1546,7 @@ Vec2Double MyStrategy::findNearestTile(const Vec2Double& tile) {
             }
         }
     }
-    std::cerr << "ERROR WITH PATH FINDING\n";
+    LOG(WARN) << "ERROR WITH PATH FINDING";
     return tile;
 }
 
@@ -1005,35 +1562,28 @@ double MyStrategy::calculatePathDistance(const Vec2Double& src, const Vec2Double
         simSrcPosision = src;
         return paths[srcIdx][dstIdx];
     }
-
-    std::vector<UnitAction> actions = {
-        StrategyGenerator::getActions(1, 1, true, false)[0],
-        StrategyGenerator::getActions(1, 0.5, true, false)[0],
-        StrategyGenerator::getActions(1, 0.25, true, false)[0],
-        StrategyGenerator::getActions(1, 0.1, true, false)[0],
-        StrategyGenerator::getActions(1, 0, true, false)[0],
-        StrategyGenerator::getActions(1, -0.1, true, false)[0],
-        StrategyGenerator::getActions(1, -0.25, true, false)[0],
-        StrategyGenerator::getActions(1, -0.5, true, false)[0],
-        StrategyGenerator::getActions(1, -1, true, false)[0],
-        StrategyGenerator::getActions(1, 1, false, true)[0],
-        StrategyGenerator::getActions(1, 0.25, false, true)[0],
-        StrategyGenerator::getActions(1, 0, false, true)[0],
-        StrategyGenerator::getActions(1, -0.25, false, true)[0],
-        StrategyGenerator::getActions(1, -1, false, true)[0],
-        StrategyGenerator::getActions(1, 1, false, false)[0],
-        StrategyGenerator::getActions(1, -1, false, false)[0]
-    };
+    if (speculation.valid && game.currentTick == speculation.tick) {
+        auto pathIt = speculation.pathDistances.find({unit.id, dstIdx});
+        if (pathIt != speculation.pathDistances.end() &&
+            areSame(pathIt->second.src.x, src.x, SPECULATION_PRECISION) &&
+            areSame(pathIt->second.src.y, src.y, SPECULATION_PRECISION) &&
+            sameJumpState(pathIt->second.jumpState, unit.jumpState)) {
+            MyStrategy::addCounter("speculativePathHits");
+            simSrcPosision = pathIt->second.simSrcPosition;
+            return pathIt->second.distance;
+        }
+    }
 
     double minPathDistance = 1000.0;
 
-    for (const auto& action : actions) {
+    for (const ActionChain& move : StrategyGenerator::PATH_MOVES) {
+        const UnitAction action = StrategyGenerator::getAction(move);
         Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 1.0, 1.0, 0.3), true, false, false, 1);
         sim.units[unit.id] = unit;
 
-        std::unordered_map<int, UnitAction> params;
+        TickActions params;
         for (int tick = 1; tick < 200; ++tick) {
-            params[unit.id] = action;
+            params.set(unit.id, action);
             sim.simulate(params);
             Vec2Double simPosition = sim.units[unit.id].position;
             if ((simPosition.y - int(simPosition.y) < game.properties.unitFallSpeed / 60 + 1e-5 ||
@@ -1052,16 +1602,12 @@ double MyStrategy::calculatePathDistance(const Vec2Double& src, const Vec2Double
         }
     }
 
-    if (MyStrategy::PERF.find("calculatePathDistance") == MyStrategy::PERF.end()) {
-        MyStrategy::PERF["calculatePathDistance"] = 0;
-    }
-    MyStrategy::PERF["calculatePathDistance"] += std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::high_resolution_clock::now() - t1).count();
+    MyStrategy::addPerf("calculatePathDistance", t1);
 
     return minPathDistance;
 }
 
-void MyStrategy::updateAction(std::unordered_map<int, Unit> units, int unitId, int enemyUnitId, UnitAction& action,
+void MyStrategy::updateAction(const std::unordered_map<int, Unit>& units, int unitId, int enemyUnitId, UnitAction& action,
                               const Game& game, Debug& debug) {
     auto t1 = std::chrono::high_resolution_clock::now();
     const Unit& unit = units.at(unitId);
@@ -1069,122 +1615,233 @@ void MyStrategy::updateAction(std::unordered_map<int, Unit> units, int unitId, i
     if (unit.weapon) {
         action.aim = predictShootAngle2(unit, units.at(enemyUnitId), game, debug, false);
     }
-    if (MyStrategy::PERF.find("updateAction") == MyStrategy::PERF.end()) {
-        MyStrategy::PERF["updateAction"] = 0;
+    MyStrategy::addPerf("updateAction", t1);
+}
+
+HitProbabilities MyStrategy::calculateHitProbability(
+    const Unit& unit,
+    const Unit& enemyUnit,
+    const Game& game,
+    Debug& debug
+) {
+    if (speculation.valid && game.currentTick == speculation.tick) {
+        auto hitIt = speculation.hitProbabilities.find({unit.id, enemyUnit.id});
+        if (hitIt != speculation.hitProbabilities.end()) {
+            MyStrategy::addCounter("speculativeHitProbabilityHits");
+            return hitIt->second;
+        }
+    }
+    if (plannerConfig.hitProbabilityMode == HitProbabilityMode::REFERENCE) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto hitProbabilities = simulateHitProbability(unit, enemyUnit, game, debug);
+        MyStrategy::addPerf("simulateHitProbability", t1);
+        return hitProbabilities;
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto hitProbabilities = estimateHitProbability(unit, enemyUnit, game, debug);
+    MyStrategy::addPerf("estimateHitProbability", t1);
+    if (plannerConfig.hitProbabilityMode == HitProbabilityMode::VALIDATE) {
+        t1 = std::chrono::high_resolution_clock::now();
+        auto reference = simulateHitProbability(unit, enemyUnit, game, debug);
+        MyStrategy::addPerf("simulateHitProbability", t1);
+        for (int i = 0; i < game.units.size(); ++i) {
+            MyStrategy::addCounter("hitProbabilityChecks");
+            if (!areSame(reference[i], hitProbabilities[i])) {
+                MyStrategy::addCounter("hitProbabilityMismatches");
+                LOG(WARN) << "Hit probability mismatch on tick " << game.currentTick << " for unit " << game.units[i].id
+                          << ": analytic " << hitProbabilities[i] << ", reference " << reference[i];
+            }
+        }
     }
-    MyStrategy::PERF["updateAction"] += std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::high_resolution_clock::now() - t1).count();
+    return hitProbabilities;
 }
 
-std::unordered_map<int, double> MyStrategy::calculateHitProbability(
+HitProbabilities MyStrategy::estimateHitProbability(
     const Unit& unit,
     const Unit& enemyUnit,
     const Game& game,
     Debug& debug
 ) {
-    int actionTicks = 25;
-    std::vector<std::vector<UnitAction>> enemyActionSets = {
-        StrategyGenerator::getActions(actionTicks, 1, true, false, false),
-        StrategyGenerator::getActions(actionTicks, -1, true, false, false),
-        StrategyGenerator::getActions(actionTicks, 1, false, true, false),
-        StrategyGenerator::getActions(actionTicks, -1, false, true, false)
-    };
+    if (game.units.size() > MAX_HIT_UNITS) {
+        throw std::length_error("estimateHitProbability: too many units");
+    }
+    const auto standAction = StrategyGenerator::getAction(0, false, false, false);
+    const double tickTime = 1.0 / game.properties.ticksPerSecond;
+
+    // My unit fires at most once in the first two ticks, replay its weapon timers to find the fan of the shot
+    std::optional<VirtualShot> shot;
+    Unit shooter = unit;
+    Unit target = enemyUnit;
+    Weapon& weapon = *shooter.weapon;
+    KinematicPredictor shooterPredictor(unit, game, HIT_PROBABILITY_FIRST_MICROTICKS);
+    KinematicPredictor targetPredictor(enemyUnit, game, HIT_PROBABILITY_FIRST_MICROTICKS);
+    std::vector<Vec2Double> shooterPositions = {unit.position};
+    std::vector<Vec2Double> targetPositions = {enemyUnit.position};
+    for (int tick = 0; tick < HIT_PROBABILITY_TICKS; ++tick) {
+        int microTicks = tick == 0 ? HIT_PROBABILITY_FIRST_MICROTICKS : 1;
+        shooterPredictor.simulateTick(standAction, microTicks);
+        shooterPositions.push_back(shooterPredictor.getPosition());
+        if (!HIT_PROBABILITY_MY_ACTIONS.chainAt(tick).shoot || shot || weapon.typ == ROCKET_LAUNCHER) {
+            continue;
+        }
 
-    const auto& tailActions = StrategyGenerator::getActions(actionTicks - 2, 0, false, false, false);
-    auto myActions = StrategyGenerator::getActions(2, 0, false, false, tailActions);
+        Vec2Double aim = predictShootAngle2(shooter, target, game, debug, false);
+        double aimAngle = fastAtan2(aim.y, aim.x);
+        weapon.spread = std::clamp(weapon.spread + findAngle(*(weapon.lastAngle), aimAngle),
+                                   weapon.params.minSpread, weapon.params.maxSpread);
+        *(weapon.lastAngle) = aimAngle;
+
+        double microTickTime = tickTime / microTicks;
+        for (int i = 0; i < microTicks; ++i) {
+            if (weapon.fireTimer && *(weapon.fireTimer) > 1e-9) {
+                *(weapon.fireTimer) -= microTickTime;
+                weapon.spread = std::clamp(weapon.spread - weapon.params.aimSpeed * microTickTime,
+                                           weapon.params.minSpread, weapon.params.maxSpread);
+                continue;
+            }
+            const Vec2Double& from = shooterPositions[tick];
+            const Vec2Double& to = shooterPositions[tick + 1];
+            double part = double(i + 1) / microTicks;
+            shot = VirtualShot{
+                unit.id,
+                unit.playerId,
+                Vec2Double(from.x + (to.x - from.x) * part, from.y + (to.y - from.y) * part + unit.size.y / 2),
+                aimAngle,
+                weapon.spread,
+                weapon.params.bullet.speed,
+                weapon.params.bullet.size,
+                tick * tickTime + i * microTickTime
+            };
+            break;
+        }
+        targetPredictor.simulateTick(standAction, microTicks);
+        shooter.position = shooterPositions[tick + 1];
+        target.position = targetPredictor.getPosition();
+    }
 
-    std::vector<std::unordered_map<int, std::vector<bool>>> bulletHits;
+    HitProbabilityEngine engine(game, HIT_PROBABILITY_TICKS, shot);
+    std::vector<UnitTrajectory> trajectories;
+    int targetIdx = 0;
+    for (const Unit& u : game.units) {
+        if (u.id == enemyUnit.id) {
+            targetIdx = trajectories.size();
+        }
+        trajectories.push_back(UnitTrajectory{
+            u.id,
+            u.playerId,
+            u.size,
+            u.id == unit.id ? shooterPositions : std::vector<Vec2Double>(HIT_PROBABILITY_TICKS + 1, u.position)
+        });
+    }
+
+    HitMatrix hits;
+    hits.unitsCount = game.units.size();
     std::vector<std::vector<DamageEvent>> events;
-    for (auto& enemyActionSet : enemyActionSets) {
+    for (const ActionSequence& enemyActions : HIT_PROBABILITY_ENEMY_ACTIONS) {
+        auto& positions = trajectories[targetIdx].positions;
+        KinematicPredictor predictor(enemyUnit, game, HIT_PROBABILITY_FIRST_MICROTICKS);
+        for (int tick = 0; tick < HIT_PROBABILITY_TICKS; ++tick) {
+            if (tick == 0) {
+                predictor.simulateTick(standAction, HIT_PROBABILITY_FIRST_MICROTICKS);
+            } else {
+                predictor.simulateTick(enemyActions[tick], 1);
+            }
+            positions[tick + 1] = predictor.getPosition();
+        }
+        engine.getBulletHits(trajectories, hits.masks[hits.scenariosCount++]);
+        events.push_back(engine.getRealBulletEvents(trajectories));
+    }
+
+    addRealBulletHits(events, unit.weapon->params.bullet.damage, game, hits);
+    return calculateHitProbability(hits);
+}
+
+HitProbabilities MyStrategy::simulateHitProbability(
+    const Unit& unit,
+    const Unit& enemyUnit,
+    const Game& game,
+    Debug& debug
+) {
+    if (game.units.size() > MAX_HIT_UNITS) {
+        throw std::length_error("simulateHitProbability: too many units");
+    }
+    int actionTicks = HIT_PROBABILITY_TICKS;
+    const auto& enemyActionSets = HIT_PROBABILITY_ENEMY_ACTIONS;
+    const auto& myActions = HIT_PROBABILITY_MY_ACTIONS;
+
+    HitMatrix hits;
+    hits.unitsCount = game.units.size();
+    hits.scenariosCount = enemyActionSets.size();
+    std::vector<std::vector<DamageEvent>> events(enemyActionSets.size());
+    threadPool->parallelFor(enemyActionSets.size(), [&](int scenarioIdx) {
+        const auto& enemyActionSet = enemyActionSets[scenarioIdx];
         Simulation sim(game, unit.playerId, debug, ColorFloat(1.0, 0.0, 0.0, 0.3), true, true, true, 1, true);
 //        sim.bullets = std::vector<Bullet>();
 
-        std::unordered_map<int, UnitAction> params;
+        TickActions params;
         for (int i = 0; i < actionTicks; ++i) {
-            if (myActions[i].shoot) {
-                updateAction(sim.units, unit.id, enemyUnit.id, myActions[i], sim.game, debug);
+            auto myAction = myActions[i];
+            if (myAction.shoot) {
+                updateAction(sim.units, unit.id, enemyUnit.id, myAction, sim.game, debug);
             }
-            params[unit.id] = myActions[i];
+            params.set(unit.id, myAction);
             if (i == 0) {
-                params[enemyUnit.id] = StrategyGenerator::getActions(1, 0, false, false, false)[0];
+                params.set(enemyUnit.id, StrategyGenerator::getAction(0, false, false, false));
             } else {
-                params[enemyUnit.id] = enemyActionSet[i];
+                params.set(enemyUnit.id, enemyActionSet[i]);
             }
-            sim.simulate(params, i == 0 ? 10 : 1);
+            sim.simulate(params, i == 0 ? HIT_PROBABILITY_FIRST_MICROTICKS : 1);
             if (sim.bullets.empty()) {
                 break;
             }
         }
 
-        bulletHits.push_back(sim.bulletHits);
-        events.push_back(sim.events);
-    }
+        for (int i = 0; i < hits.unitsCount; ++i) {
+            hits.masks[scenarioIdx][i] = sim.bulletHits[game.units[i].id];
+        }
+        events[scenarioIdx] = sim.events;
+    });
 
-    addRealBulletHits(events, unit.weapon->params.bullet.damage, bulletHits);
-    return calculateHitProbability(bulletHits);
+    addRealBulletHits(events, unit.weapon->params.bullet.damage, game, hits);
+    return calculateHitProbability(hits);
 }
 
 
 void MyStrategy::addRealBulletHits(const std::vector<std::vector<DamageEvent>>& events,
                                    int bulletDamage,
-                                   std::vector<std::unordered_map<int, std::vector<bool>>>& bulletHits) {
-    std::unordered_map<int, double> minUnitDamage;
-    std::vector<std::unordered_map<int, double>> unitDamage;
-    for (const auto& simEvents : events) {
-        std::unordered_map<int, double> damage;
-        for (const DamageEvent& event : simEvents) {
-            if (damage.find(event.unitId) == damage.end()) {
-                damage[event.unitId] = event.damage;
-            } else {
-                damage[event.unitId] += event.damage;
+                                   const Game& game,
+                                   HitMatrix& hits) {
+    std::array<std::array<double, MAX_HIT_UNITS>, HitMatrix::MAX_SCENARIOS> damage{};
+    for (int i = 0; i < hits.scenariosCount; ++i) {
+        for (const DamageEvent& event : events[i]) {
+            int idx = unitIndex(game, event.unitId);
+            if (idx >= 0) {
+                damage[i][idx] += event.damage;
             }
         }
-
-        if (minUnitDamage.empty()) {
-            minUnitDamage = damage;
-        } else {
-            for (const auto&[unitId, dmg] : damage) {
-                if (dmg < minUnitDamage[unitId]) {
-                    minUnitDamage[unitId] = dmg;
-                }
-            }
-        }
-        unitDamage.push_back(damage);
     }
 
-    for (int i = 0; i < unitDamage.size(); ++i) {
-        for (const auto&[unitId, dmg] : unitDamage[i]) {
-            if (dmg - minUnitDamage[unitId] >= bulletDamage) {
-                std::fill(bulletHits[i][unitId].begin(), bulletHits[i][unitId].end(), true);
-            }
+    for (int unitIdx = 0; unitIdx < hits.unitsCount; ++unitIdx) {
+        double minDamage = damage[0][unitIdx];
+        for (int i = 1; i < hits.scenariosCount; ++i) {
+            minDamage = std::min(minDamage, damage[i][unitIdx]);
         }
-    }
-}
-
-std::unordered_map<int, double> MyStrategy::calculateHitProbability(
-    const std::vector<std::unordered_map<int, std::vector<bool>>>& bulletHits
-) {
-    std::unordered_map<int, std::vector<bool>> hitsIntersection = bulletHits[0];
-    int hitsSize = 0;
-
-    for (int i = 1; i < bulletHits.size(); ++i) {
-        for (const auto&[unitId, hits] : bulletHits[i]) {
-            hitsSize = hits.size();
-            for (int j = 0; j < hitsSize; ++j) {
-                hitsIntersection[unitId][j] = hitsIntersection[unitId][j] && hits[j];
+        for (int i = 0; i < hits.scenariosCount; ++i) {
+            if (damage[i][unitIdx] - minDamage >= bulletDamage) {
+                hits.masks[i][unitIdx].set();
             }
         }
     }
+}
 
-    std::unordered_map<int, double> hitProbabilities;
-    for (const auto&[unitId, hits] : hitsIntersection) {
-        int hitsCount = 0;
-        for (bool isHit : hits) {
-            if (isHit) {
-                ++hitsCount;
-            }
+HitProbabilities MyStrategy::calculateHitProbability(const HitMatrix& hits) {
+    HitProbabilities hitProbabilities{};
+    for (int unitIdx = 0; unitIdx < hits.unitsCount; ++unitIdx) {
+        HitMask intersection = hits.masks[0][unitIdx];
+        for (int i = 1; i < hits.scenariosCount; ++i) {
+            intersection &= hits.masks[i][unitIdx];
         }
-        hitProbabilities[unitId] = double(hitsCount) / hitsSize;
+        hitProbabilities[unitIdx] = double(intersection.count()) / intersection.size();
     }
     return hitProbabilities;
 }
@@ -1,23 +1,231 @@
 #ifndef _MY_STRATEGY_HPP_
 #define _MY_STRATEGY_HPP_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
 #include "Debug.hpp"
 #include "model/CustomData.hpp"
 #include "model/Game.hpp"
+#include "model/PlayerView.hpp"
 #include "model/Unit.hpp"
 #include "model/UnitAction.hpp"
 #include "Simulation.hpp"
+#include "ThreadPool.hpp"
+#include "StrategyGenerator.hpp"
+#include "VisibilityMatrix.hpp"
+#include "ExposureField.hpp"
+
+// Best action sequence found on the previous tick together with the simulated states of my unit
+// after each of its ticks, used to warm start the next planning pass.
+struct Plan {
+    int tick;
+    ActionSequence actions;
+    std::vector<Unit> trajectory;
+    int enemyBulletsCount;
+    bool quiet;
+};
+
+// Candidate action sequence of my unit together with its simulation over the whole planning horizon.
+// snapshot holds the simulation at the tick where the beam search branches off this candidate.
+struct Candidate {
+    ActionSequence actions;
+    std::shared_ptr<Simulation> sim;
+    std::shared_ptr<Simulation> snapshot;
+    std::vector<Unit> trajectory;
+    double targetDistance;
+    // Simulation was stopped early because the candidate can't beat the incumbent any more
+    bool pruned = false;
+};
+
+// Incumbent the candidates are compared against while they are simulated.
+struct PruningBound {
+    double incumbentScore;
+    double incumbentTargetDistance;
+    double targetImportance;
+    // Upper bound of the undiscounted score any candidate can still gain over the planning horizon
+    double maxGain;
+};
+
+// Enemy behaviour used in my candidate simulations: best response actions for the first ticks, then standing still.
+struct EnemyModel {
+    std::vector<int> unitIds;
+    std::vector<UnitAction> actions;
+};
+
+enum class HitProbabilityMode {
+    // Closed form estimate of HitProbabilityEngine
+    ANALYTIC,
+    // Virtual bullet fans simulated by Simulation
+    REFERENCE,
+    // Both, the differences are logged and counted
+    VALIDATE
+};
+
+struct PlannerConfig {
+    // 0 disables the beam search over chained actions
+    int beamWidth = 2;
+    // Ticks where the beam search switches to another ActionChain, one search level per tick
+    std::vector<int> beamBranchTicks = {3, 12};
+    int planningBudgetMs = 15;
+    // A day, the beam search finishes every level and the decisions don't depend on the speed of the machine
+    static constexpr int UNLIMITED_PLANNING_BUDGET_MS = 24 * 60 * 60 * 1000;
+    // Keep the full event lists of the planner simulations for the logs, otherwise only their scores are tracked
+    bool debugEvents = false;
+    HitProbabilityMode hitProbabilityMode = HitProbabilityMode::ANALYTIC;
+    // Squared tiles of distance a target tile may be worse by to avoid one point per second of expected damage from
+    // the ExposureField. With 2 a tile in the open in front of an assault rifle (5 damage 10 times a second) costs as
+    // much as being 10 tiles further away.
+    double exposureCost = 2.0;
+
+    // Defaults overridden by the environment variables, AICUP_BEAM_WIDTH etc. with the default prefix
+    static PlannerConfig fromEnvironment(const std::string& prefix = "AICUP_");
+};
+
+// Hit probabilities of a shot for the units, in the order of Game::units
+using HitProbabilities = std::array<double, MAX_HIT_UNITS>;
+
+// Quarter of a tile is close enough for the enemy to prefer the same dodge
+constexpr double ENEMY_RESPONSE_PRECISION = 0.25;
+
+// Quantized state of an enemy relative to my unit, enemies in equal states are expected to dodge the same way.
+struct EnemyResponseKey {
+    int enemyId;
+    int x;
+    int y;
+    int dx;
+    int dy;
+    bool canJump;
+    bool targetCanJump;
+    int weaponType;
+    int targetWeaponType;
+
+    bool operator==(const EnemyResponseKey& other) const {
+        return enemyId == other.enemyId && x == other.x && y == other.y && dx == other.dx && dy == other.dy &&
+               canJump == other.canJump && targetCanJump == other.targetCanJump &&
+               weaponType == other.weaponType && targetWeaponType == other.targetWeaponType;
+    }
+};
+
+struct EnemyResponseKeyHash {
+    size_t operator()(const EnemyResponseKey& key) const {
+        size_t hash = 0;
+        for (int value : {key.enemyId, key.x, key.y, key.dx, key.dy, int(key.canJump), int(key.targetCanJump),
+                          key.weaponType, key.targetWeaponType}) {
+            hash = hash * 1000003 + std::hash<int>()(value);
+        }
+        return hash;
+    }
+};
+
+// Best response of an enemy together with its position after the first tick of it.
+struct EnemyResponse {
+    UnitAction action;
+    Vec2Double predictedPosition;
+};
+
+// Shooter and target predictShootAngle2 was called for on a tick.
+struct AimKey {
+    int shooterId;
+    int targetId;
+    int tick;
+    bool simulateFallDown;
+
+    bool operator==(const AimKey& other) const {
+        return shooterId == other.shooterId && targetId == other.targetId && tick == other.tick &&
+               simulateFallDown == other.simulateFallDown;
+    }
+};
+
+struct AimKeyHash {
+    size_t operator()(const AimKey& key) const {
+        size_t hash = 0;
+        for (int value : {key.shooterId, key.targetId, key.tick, int(key.simulateFallDown)}) {
+            hash = hash * 1000003 + std::hash<int>()(value);
+        }
+        return hash;
+    }
+};
+
+// Aim memoized for an AimKey together with the shooter and target state it was computed from.
+struct AimMemo {
+    Vec2Double shooterPosition;
+    WeaponType weaponType;
+    double lastAngle;
+    double spread;
+    double fireTimer;
+    Vec2Double targetPosition;
+    JumpState targetJumpState;
+    Vec2Double aim;
+
+    AimMemo(const Unit& shooter, const Unit& target, const Vec2Double& aim);
+
+    bool matches(const Unit& shooter, const Unit& target) const;
+};
+
+// State shared by all my units within one tick, built once before any of them is planned.
+struct TickContext {
+    int tick = -1;
+    int playerId = -1;
+    std::vector<Unit> myUnits;
+    std::vector<Unit> enemyUnits;
+    // Action sequences my units follow in the simulations of their teammates
+    std::unordered_map<int, ActionSequence> teamPlans;
+};
+
+// Path distance found from a position of a unit, kept together with the state the simulated moves depend on.
+struct SpeculativePath {
+    Vec2Double src;
+    JumpState jumpState;
+    double distance;
+    Vec2Double simSrcPosition;
+};
+
+// Next tick predicted while the server is busy together with results its planning needs. prepareTick compares
+// the real state with the prediction and the results are only used when they match.
+struct Speculation {
+    int tick = -1;
+    Game game;
+    bool valid = false;
+    // By shooter and target id
+    std::map<std::pair<int, int>, HitProbabilities> hitProbabilities;
+    // By unit id and destination tile, only the distances which needed simulated moves
+    std::map<std::pair<int, int>, SpeculativePath> pathDistances;
+};
 
 class MyStrategy {
 public:
-    MyStrategy();
+    explicit MyStrategy(int threadsCount = 1, PlannerConfig plannerConfig = PlannerConfig());
 
     static std::unordered_map<std::string, int> PERF;
+    static std::unordered_map<std::string, int> COUNTERS;
+    static std::mutex PERF_MUTEX;
+
+    // Accumulated by every thread on its own, the hot loops of the pool workers don't share a lock.
+    // The names are string literals.
+    static void addPerf(const char* name, std::chrono::high_resolution_clock::time_point start);
+    static void addCounter(const char* name, int value = 1);
+    // Adds what the threads accumulated to PERF and COUNTERS, once per tick and before they are read
+    static void mergePerf();
+
+    // Plans all my units of the tick one by one, every unit sees the plans chosen for the previous ones
+    std::unordered_map<int, UnitAction> getActions(const PlayerView& playerView, Debug& debug);
+
+    void prepareTick(const Game& game, int playerId, Debug& debug);
+
+    // Runs while waiting for the next tick: predicts it from the actions just sent and the enemy model, then finds
+    // the path distances, hit probabilities and enemy responses of the predicted state. Returns early once
+    // cancelled, must not overlap with planning.
+    void speculate(const PlayerView& playerView, const std::unordered_map<int, UnitAction>& actions, Debug& debug,
+                   const std::atomic<bool>& cancelled);
 
     UnitAction getAction(const Unit& unit, const Game& game, Debug& debug);
 
     std::optional<UnitAction> doSuicide(const Unit& unit, const Game& game, Debug& debug);
 
+    // Memoized per shooter, target and tick within a planning pass
     Vec2Double predictShootAngle2(const Unit& unit, const Unit& enemyUnit, const Game& game, Debug& debug, bool simulateFallDown = true);
 
     std::optional<UnitAction> avoidBullets(
@@ -27,25 +235,75 @@ public:
         const Vec2Double& targetPos,
         double targetImportance,
         const UnitAction& targetAction,
+        bool warmStart,
+        Debug& debug
+    );
+
+    EnemyModel getEnemyResponses(const Unit& unit, const Game& game, const UnitAction& targetAction, Debug& debug);
+
+    EnemyResponseKey getEnemyResponseKey(const Unit& unit, const Unit& enemy);
+
+    void invalidateEnemyResponses(const Game& game, int playerId);
+
+    void simulateCandidate(Candidate& candidate, int fromTick, int toTick, const Unit& unit, int enemyUnitId,
+                           const EnemyModel& enemies, const Vec2Double& targetPos, const PruningBound* bound,
+                           Debug& debug);
+
+    bool canBeat(const Candidate& candidate, const PruningBound& bound, int tick);
+
+    double maxScoreGain(const Unit& unit, const Game& game, int actionTicks);
+
+    void beamSearch(
+        std::vector<Candidate> beam,
+        std::optional<Candidate>& best,
+        const Unit& unit,
+        int enemyUnitId,
+        const Game& game,
+        const EnemyModel& enemies,
+        const Vec2Double& targetPos,
+        double targetImportance,
+        const UnitAction& targetAction,
+        int actionTicks,
+        std::chrono::high_resolution_clock::time_point deadline,
         Debug& debug
     );
 
+    bool matchesPlan(const Unit& unit, const Game& game);
+
     bool shouldShoot(Unit unit, const Unit& enemyUnit, Vec2Double aim, const Game& game, Debug& debug);
 
-    std::unordered_map<int, double> calculateHitProbability(
+    HitProbabilities calculateHitProbability(
+        const Unit& unit,
+        const Unit& enemyUnit,
+        const Game& game,
+        Debug& debug
+    );
+
+    HitProbabilities estimateHitProbability(
         const Unit& unit,
         const Unit& enemyUnit,
         const Game& game,
         Debug& debug
     );
 
+    // Reference implementation firing fans of virtual bullets in full simulations
+    HitProbabilities simulateHitProbability(
+        const Unit& unit,
+        const Unit& enemyUnit,
+        const Game& game,
+        Debug& debug
+    );
+
+    // Marks every ray as a hit for the units real bullets damage more in a scenario than in the mildest one
     void addRealBulletHits(
         const std::vector<std::vector<DamageEvent>>& events,
         int bulletDamage,
-        std::vector<std::unordered_map<int, std::vector<bool>>>& bulletHits
+        const Game& game,
+        HitMatrix& hits
     );
 
-    std::unordered_map<int, double> calculateHitProbability(const std::vector<std::unordered_map<int, std::vector<bool>>>& bulletHits);
+    // Part of the rays which hit a unit in every scenario
+    HitProbabilities calculateHitProbability(const HitMatrix& hits);
 
     int compareSimulations(
         const Simulation& sim1,
@@ -64,7 +322,7 @@ public:
 
     void buildPathGraph(const Unit& unit, const Game& game, Debug& debug);
 
-    void pathDfs(int x, int y, const std::vector<std::vector<UnitAction>>& actions, const Unit& unit, const Game& game, Debug& debug);
+    void pathDfs(int x, int y, const Unit& unit, const Game& game, Debug& debug);
 
     void floydWarshall();
 
@@ -72,20 +330,44 @@ public:
 
     Vec2Double fromPathsIndex(int idx);
 
+    // Distributes the weapons on the map between my units which have no weapon or a rocket launcher
+    void assignTargetWeapons(const Game& game, int playerId, Debug& debug);
+
+    // Reachable tile with the least squared distance to the point plus the weighted exposure of the tile, among
+    // the tiles at least minDistanceSqr away from the enemy
+    Vec2Double findCoveredTile(const Vec2Double& point, const Vec2Double& enemyPosition, double minDistanceSqr);
+
     Vec2Double findTargetPosition(const Unit& unit, const Unit* nearestEnemy, const Game& game, Debug& debug, double& targetImportance);
 
     double calculatePathDistance(const Vec2Double& src, const Vec2Double& dst, const Unit& unit, const Game& game, Debug& debug, Vec2Double& simSrcPosision);
 
     Vec2Double findNearestTile(const Vec2Double& src);
 
-    void updateAction(std::unordered_map<int, Unit> units, int unitId, int enemyUnitId, UnitAction& action, const Game& game, Debug& debug);
+    void updateAction(const std::unordered_map<int, Unit>& units, int unitId, int enemyUnitId, UnitAction& action, const Game& game, Debug& debug);
 
 private:
+    Vec2Double calculateShootAngle(const Unit& unit, const Unit& enemyUnit, const Game& game, bool simulateFallDown);
+
+    // calculatePathDistance of the predicted state, keeps the distances which needed simulated moves
+    double speculatePathDistance(const Vec2Double& src, const Vec2Double& dst, const Unit& unit, const Game& game,
+                                 Debug& debug);
+
+    static std::atomic<int> PLANNING_PASSES;
+
+    std::unique_ptr<ThreadPool> threadPool;
+    PlannerConfig plannerConfig;
+    TickContext tickContext;
+    // Incremented on every tick, aims memoized by the threads are dropped once it changes
+    int planningPass = 0;
     std::shared_ptr<Simulation> simulation;
-    std::optional<Unit> nextUnit;
-    std::optional<UnitAction> prevAction;
+    std::unordered_map<int, Plan> plans;
+    Speculation speculation;
+    std::unordered_map<EnemyResponseKey, EnemyResponse, EnemyResponseKeyHash> enemyResponses;
+    std::mutex enemyResponsesMutex;
     std::array<std::array<int16_t, 1200>, 1200> paths;
     std::array<bool, 1200> isPathFilled;
+    VisibilityMatrix visibility;
+    ExposureField exposure;
     std::unordered_map<int, std::optional<LootBox>> unitTargetWeapons;
     std::unordered_map<int, bool> suicide;
     std::unordered_map<int, int> hangTick;
@@ -0,0 +1,299 @@
+#include "SharedMemoryStream.hpp"
+#include <stdexcept>
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t CHANNEL_MAGIC = 0x41494353;
+// Power of two, a message of the server is ~20KB
+constexpr uint32_t RING_CAPACITY = 1 << 20;
+// ~10us of polling before the reader goes to sleep
+constexpr int SPIN_ITERATIONS = 2000;
+// A sleeping side wakes up that often to check that the other side is still running
+constexpr int PEER_CHECK_MS = 100;
+
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs) {
+    timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+}
+
+struct SharedMemoryChannel::Ring {
+    // Bytes written and read so far, wrapping around. Each of them is stored by one side only.
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    // Set while the reader sleeps on head or the writer sleeps on tail
+    alignas(64) std::atomic<uint32_t> readerSleeping;
+    std::atomic<uint32_t> writerSleeping;
+    alignas(64) char data[RING_CAPACITY];
+};
+
+struct SharedMemoryChannel::Layout {
+    std::atomic<uint32_t> magic;
+    std::atomic<int32_t> serverPid;
+    std::atomic<int32_t> clientPid;
+    std::atomic<uint32_t> serverClosed;
+    std::atomic<uint32_t> clientClosed;
+    Ring toClient;
+    Ring toServer;
+};
+
+class SharedMemoryChannel::Input : public InputStream {
+public:
+    explicit Input(std::shared_ptr<SharedMemoryChannel> channel)
+        : channel(std::move(channel))
+        , ring(this->channel->inputRing())
+        , tail(ring.tail.load()) {
+    }
+
+    void readBytes(char* buffer, size_t byteCount) override {
+        while (byteCount > 0) {
+            size_t count = readSome(buffer, byteCount);
+            buffer += count;
+            byteCount -= count;
+        }
+    }
+
+    size_t readSome(char* buffer, size_t maxCount) override {
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        if (head == tail) {
+            head = channel->waitReadable(ring, tail);
+        }
+        uint32_t offset = tail & (RING_CAPACITY - 1);
+        size_t count = std::min({size_t(head - tail), maxCount, size_t(RING_CAPACITY - offset)});
+        std::memcpy(buffer, ring.data + offset, count);
+        tail += count;
+        ring.tail.store(tail);
+        if (ring.writerSleeping.load()) {
+            futexWake(ring.tail);
+        }
+        return count;
+    }
+
+private:
+    std::shared_ptr<SharedMemoryChannel> channel;
+    Ring& ring;
+    uint32_t tail;
+};
+
+class SharedMemoryChannel::Output : public OutputStream {
+public:
+    explicit Output(std::shared_ptr<SharedMemoryChannel> channel)
+        : channel(std::move(channel))
+        , ring(this->channel->outputRing())
+        , head(ring.head.load()) {
+    }
+
+    void writeBytes(const char* buffer, size_t byteCount) override {
+        while (byteCount > 0) {
+            uint32_t tail = ring.tail.load(std::memory_order_acquire);
+            if (head - tail == RING_CAPACITY) {
+                // The reader can't drain what isn't published yet
+                flush();
+                channel->waitWritable(ring, tail);
+                continue;
+            }
+            uint32_t offset = head & (RING_CAPACITY - 1);
+            size_t count = std::min({byteCount, size_t(RING_CAPACITY - (head - tail)),
+                                     size_t(RING_CAPACITY - offset)});
+            std::memcpy(ring.data + offset, buffer, count);
+            head += count;
+            buffer += count;
+            byteCount -= count;
+        }
+    }
+
+    void flush() override {
+        if (ring.head.load(std::memory_order_relaxed) == head) {
+            return;
+        }
+        ring.head.store(head);
+        if (ring.readerSleeping.load()) {
+            futexWake(ring.head);
+        }
+    }
+
+private:
+    std::shared_ptr<SharedMemoryChannel> channel;
+    Ring& ring;
+    uint32_t head;
+};
+
+std::shared_ptr<SharedMemoryChannel> SharedMemoryChannel::create(const std::string& name) {
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to create shared memory " + name);
+    }
+    if (ftruncate(fd, sizeof(Layout)) == -1) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to size shared memory " + name);
+    }
+    void* memory = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory " + name);
+    }
+    // The new object is zero filled, only the ids are set
+    Layout* layout = static_cast<Layout*>(memory);
+    layout->serverPid.store(getpid());
+    layout->magic.store(CHANNEL_MAGIC);
+    return std::shared_ptr<SharedMemoryChannel>(new SharedMemoryChannel(name, layout, true));
+}
+
+std::shared_ptr<SharedMemoryChannel> SharedMemoryChannel::open(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open shared memory " + name);
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || size_t(status.st_size) != sizeof(Layout)) {
+        close(fd);
+        throw std::runtime_error("Shared memory " + name + " is not a channel");
+    }
+    void* memory = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Failed to map shared memory " + name);
+    }
+    Layout* layout = static_cast<Layout*>(memory);
+    int32_t noClient = 0;
+    if (layout->magic.load() != CHANNEL_MAGIC || !layout->clientPid.compare_exchange_strong(noClient, getpid())) {
+        munmap(memory, sizeof(Layout));
+        throw std::runtime_error("Shared memory " + name + " is not a free channel");
+    }
+    return std::shared_ptr<SharedMemoryChannel>(new SharedMemoryChannel(name, layout, false));
+}
+
+SharedMemoryChannel::SharedMemoryChannel(const std::string& name, Layout* layout, bool server)
+    : name(name)
+    , layout(layout)
+    , server(server) {
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+    (server ? layout->serverClosed : layout->clientClosed).store(1);
+    for (Ring* ring : {&layout->toClient, &layout->toServer}) {
+        futexWake(ring->head);
+        futexWake(ring->tail);
+    }
+    munmap(layout, sizeof(Layout));
+    if (server) {
+        shm_unlink(name.c_str());
+    }
+}
+
+std::shared_ptr<InputStream> SharedMemoryChannel::getInputStream() {
+    return std::make_shared<Input>(shared_from_this());
+}
+
+std::shared_ptr<OutputStream> SharedMemoryChannel::getOutputStream() {
+    return std::make_shared<Output>(shared_from_this());
+}
+
+void SharedMemoryChannel::setReadTimeout(std::optional<double> seconds) {
+    readTimeout = seconds;
+}
+
+SharedMemoryChannel::Ring& SharedMemoryChannel::inputRing() {
+    return server ? layout->toServer : layout->toClient;
+}
+
+SharedMemoryChannel::Ring& SharedMemoryChannel::outputRing() {
+    return server ? layout->toClient : layout->toServer;
+}
+
+uint32_t SharedMemoryChannel::waitReadable(Ring& ring, uint32_t tail) {
+    for (int i = 0; i < SPIN_ITERATIONS; ++i) {
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        if (head != tail) {
+            return head;
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        // The writer checks the flag after publishing head, so either it sees the flag or we see the new head
+        ring.readerSleeping.store(1);
+        uint32_t head = ring.head.load();
+        if (head != tail) {
+            ring.readerSleeping.store(0);
+            return head;
+        }
+        checkPeer(true, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        futexWait(ring.head, head, PEER_CHECK_MS);
+    }
+}
+
+uint32_t SharedMemoryChannel::waitWritable(Ring& ring, uint32_t tail) {
+    while (true) {
+        ring.writerSleeping.store(1);
+        uint32_t current = ring.tail.load();
+        if (current != tail) {
+            ring.writerSleeping.store(0);
+            return current;
+        }
+        checkPeer(false, 0.0);
+        futexWait(ring.tail, current, PEER_CHECK_MS);
+    }
+}
+
+void SharedMemoryChannel::checkPeer(bool reading, double waitedSeconds) const {
+    if ((server ? layout->clientClosed : layout->serverClosed).load()) {
+        throw std::runtime_error("The other side closed the shared memory channel");
+    }
+    int32_t peerPid = (server ? layout->clientPid : layout->serverPid).load();
+    if (peerPid != 0 && kill(peerPid, 0) == -1 && errno == ESRCH) {
+        throw std::runtime_error("The other side of the shared memory channel exited");
+    }
+    if (reading && readTimeout && waitedSeconds > *readTimeout) {
+        throw std::runtime_error("Timed out reading from shared memory");
+    }
+}
+
+#else
+
+std::shared_ptr<SharedMemoryChannel> SharedMemoryChannel::create(const std::string& name) {
+    throw std::runtime_error("Shared memory channels are supported on Linux only");
+}
+
+std::shared_ptr<SharedMemoryChannel> SharedMemoryChannel::open(const std::string& name) {
+    throw std::runtime_error("Shared memory channels are supported on Linux only");
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+}
+
+std::shared_ptr<InputStream> SharedMemoryChannel::getInputStream() {
+    throw std::runtime_error("Shared memory channels are supported on Linux only");
+}
+
+std::shared_ptr<OutputStream> SharedMemoryChannel::getOutputStream() {
+    throw std::runtime_error("Shared memory channels are supported on Linux only");
+}
+
+void SharedMemoryChannel::setReadTimeout(std::optional<double> seconds) {
+    readTimeout = seconds;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _SHAREDMEMORYSTREAM_HPP_
+#define _SHAREDMEMORYSTREAM_HPP_
+
+
+#include <memory>
+#include <optional>
+#include <string>
+#include "Stream.hpp"
+
+// Byte streams between two processes over a POSIX shared memory object with a ring buffer for each direction.
+// A reader spins shortly and then sleeps on a futex until the writer flushes, so a tick costs no system call while
+// the other side is quick. The server creates the channel, the client opens it by name. Linux only.
+class SharedMemoryChannel : public std::enable_shared_from_this<SharedMemoryChannel> {
+public:
+    static std::shared_ptr<SharedMemoryChannel> create(const std::string& name);
+    static std::shared_ptr<SharedMemoryChannel> open(const std::string& name);
+    ~SharedMemoryChannel();
+
+    SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+    SharedMemoryChannel& operator=(const SharedMemoryChannel&) = delete;
+
+    std::shared_ptr<InputStream> getInputStream();
+    std::shared_ptr<OutputStream> getOutputStream();
+
+    // Reads waiting longer throw, they wait until the other side exits by default
+    void setReadTimeout(std::optional<double> seconds);
+
+private:
+    struct Ring;
+    struct Layout;
+    class Input;
+    class Output;
+
+    SharedMemoryChannel(const std::string& name, Layout* layout, bool server);
+
+    Ring& inputRing();
+    Ring& outputRing();
+    // Wait until the value of head or tail moves from observed and return the new value. Throw when the other side
+    // is gone or the read timeout runs out.
+    uint32_t waitReadable(Ring& ring, uint32_t tail);
+    uint32_t waitWritable(Ring& ring, uint32_t tail);
+    void checkPeer(bool reading, double waitedSeconds) const;
+
+    std::string name;
+    Layout* layout;
+    bool server;
+    std::optional<double> readTimeout;
+};
+
+#endif
@@ -2,8 +2,12 @@
 
 #include "Simulation.hpp"
 #include "Util.hpp"
+#include "AngleMath.hpp"
 #include "MyStrategy.hpp"
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
 #include <chrono>
 #include <unordered_set>
 
@@ -25,21 +29,43 @@ Simulation::Simulation(Game game,
     , simMove(simMove)
     , simBullets(simBullets)
     , simShoot(simShoot)
-    , calcHitProbability(calcHitProbability) {
+    , calcHitProbability(calcHitProbability)
+    , recordEvents(true) {
 
     bullets = this->game.bullets;
     startTick = this->game.currentTick;
-    shootBulletsCount = calcHitProbability ? 12 : 0;
+    shootBulletsCount = calcHitProbability ? HIT_RAYS_PER_SIDE : 0;
     for (const Unit& u : this->game.units) {
         units[u.id] = u;
         if (calcHitProbability) {
-            bulletHits[u.id] = std::vector<bool>(2 * shootBulletsCount + 1, false);
+            bulletHits[u.id] = HitMask();
         }
     }
     ticksMultiplier = 1.0 / (game.properties.ticksPerSecond  * microTicks);
 }
 
+void TickActions::set(int unitId, const UnitAction& action) {
+    for (int i = 0; i < count; ++i) {
+        if (actions[i].first == unitId) {
+            actions[i].second = action;
+            return;
+        }
+    }
+    if (count == int(actions.size())) {
+        throw std::length_error("TickActions: too many units");
+    }
+    actions[count++] = {unitId, action};
+}
+
 void Simulation::simulate(const std::unordered_map<int, UnitAction>& actions, std::optional<int> microTicks, bool simSuicide) {
+    TickActions tickActions;
+    for (const auto& [unitId, action] : actions) {
+        tickActions.set(unitId, action);
+    }
+    simulate(tickActions, microTicks, simSuicide);
+}
+
+void Simulation::simulate(const TickActions& actions, std::optional<int> microTicks, bool simSuicide) {
     auto t1 = std::chrono::high_resolution_clock::now();
     if (microTicks) {
         ticksMultiplier = 1.0 / (game.properties.ticksPerSecond * *microTicks);
@@ -50,7 +76,7 @@ void Simulation::simulate(const std::unordered_map<int, UnitAction>& actions, st
     for (const auto& [unitId, action] : actions) {
         if (units[unitId].weapon && simShoot) {
             Weapon& weapon = *units[unitId].weapon;
-            double aimAngle = atan2(action.aim.y, action.aim.x);
+            double aimAngle = fastAtan2(action.aim.y, action.aim.x);
             weapon.spread += findAngle(*(weapon.lastAngle), aimAngle);
             weapon.spread = std::clamp(
                 weapon.spread,
@@ -84,11 +110,7 @@ void Simulation::simulate(const std::unordered_map<int, UnitAction>& actions, st
         }
     }
 
-    if (MyStrategy::PERF.find("simulate") == MyStrategy::PERF.end()) {
-        MyStrategy::PERF["simulate"] = 0;
-    }
-    MyStrategy::PERF["simulate"] += std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::high_resolution_clock::now() - t1).count();
+    MyStrategy::addPerf("simulate", t1);
 }
 
 void Simulation::move(const UnitAction& action, int unitId) {
@@ -259,7 +281,7 @@ void Simulation::simulateHealthPack(int unitId) {
                 lootBoxIdx = i;
                 units[unitId].health += game.properties.healthPackHealth;
                 units[unitId].health = std::clamp(units[unitId].health, 0.0, double(game.properties.unitMaxHealth));
-                events.push_back(DamageEvent{
+                addEvent(DamageEvent{
                     game.currentTick - startTick,
                     unitId,
                     double(-game.properties.healthPackHealth),
@@ -332,7 +354,7 @@ void Simulation::simulateSuicide(int unitId) {
                 return;
             }
             for (int killedEnemyUnitId : killedEnemyUnits) {
-                events.push_back(DamageEvent{
+                addEvent(DamageEvent{
                     game.currentTick - startTick,
                     killedEnemyUnitId,
                     100.0,
@@ -354,14 +376,14 @@ void Simulation::explode(const Bullet& bullet,
             return;
         }
         if (calcHitProbability && !bullet.real) {
-            bulletHits[*unitId][bullet.virtualParams->angleIndex] = true;
+            bulletHits[*unitId].set(bullet.virtualParams->angleIndex);
         } else {
 //            units[*unitId].health -= bullet.damage;
 
             double angle = 0.0;
             double rawProb = 0.0;
             double prob = calculateHitProbability(bullet, units[*unitId], angle, rawProb);
-            events.push_back(DamageEvent{
+            addEvent(DamageEvent{
                 game.currentTick - startTick,
                 *unitId,
                 bullet.damage,
@@ -384,14 +406,14 @@ void Simulation::explode(const Bullet& bullet,
         for (const auto& [id, unit]: units) {
             if (intersectRects(explosion, Rect(unit))) {
                 if (calcHitProbability && !bullet.real) {
-                    bulletHits[*unitId][bullet.virtualParams->angleIndex] = true;
+                    bulletHits[*unitId].set(bullet.virtualParams->angleIndex);
                 } else {
 //                    units[id].health -= bullet.explosionParams->damage;
 
                     double angle = 0.0;
                     double rawProb = 0.0;
                     double prob = 1.0;
-                    events.push_back(DamageEvent{
+                    addEvent(DamageEvent{
                         game.currentTick - startTick,
                         id,
                         double(bullet.explosionParams->damage),
@@ -407,6 +429,21 @@ void Simulation::explode(const Bullet& bullet,
     }
 }
 
+void Simulation::addEvent(const DamageEvent& event) {
+    if (score.isActive()) {
+        auto unitIt = units.find(event.unitId);
+        score.add(event, unitIt == units.end() ? -1 : unitIt->second.playerId);
+    }
+    if (recordEvents) {
+        events.push_back(event);
+    }
+}
+
+void Simulation::trackScore(const Unit& unit, double multiplier, bool recordEvents) {
+    score = ScoreAccumulator(unit.id, unit.playerId, unit.health, multiplier);
+    this->recordEvents = recordEvents;
+}
+
 double Simulation::calculateHitProbability(const Bullet& bullet, const Unit& targetUnit, double& angle, double& rawProb, bool explosion) {
     if (bullet.real) {
         return 1.0;
@@ -427,7 +464,7 @@ double Simulation::calculateHitProbability(const Bullet& bullet, const Unit& tar
         targetUnit.position.y + targetUnit.size.y / 2 - shootPosition.y
     );
 
-    angle = fmod(atan2(aim.y, aim.x) + 4 * M_PI, M_PI) * 57.2958;
+    angle = fmod(fastAtan2(aim.y, aim.x) + 4 * M_PI, M_PI) * 57.2958;
     if (angle > 90.0) {
         angle = 180.0 - angle;
     }
@@ -491,15 +528,15 @@ void Simulation::simulateShoot(const UnitAction& action, int unitId) {
 
 void Simulation::createBullets(const UnitAction& action, int unitId, const Rect& targetUnit) {
     Unit& unit = units[unitId];
-    double aimAngle = atan2(action.aim.y, action.aim.x);
-    int angleStepsCount = 2 * shootBulletsCount + 1;
+    std::array<Vec2Double, 2 * HIT_RAYS_PER_SIDE + 1> directions;
+    fanDirections(normalize(action.aim), unit.weapon->spread, shootBulletsCount, directions.data());
 
     for (int i = -shootBulletsCount; i <= shootBulletsCount; ++i) {
         auto bulletPos = unit.position;
         bulletPos.y += unit.size.y / 2;
-        double angle = aimAngle + unit.weapon->spread * i / (shootBulletsCount == 0 ? 1 : shootBulletsCount);
-        auto bulletVel = Vec2Double(cos(angle) * unit.weapon->params.bullet.speed,
-                                    sin(angle) * unit.weapon->params.bullet.speed);
+        const Vec2Double& direction = directions[i + shootBulletsCount];
+        auto bulletVel = Vec2Double(direction.x * unit.weapon->params.bullet.speed,
+                                    direction.y * unit.weapon->params.bullet.speed);
 
         Bullet bullet(
             unit.weapon->typ,
@@ -527,3 +564,56 @@ void Simulation::createBullets(const UnitAction& action, int unitId, const Rect&
     }
 
 }
+
+ScoreAccumulator::ScoreAccumulator(int unitId, int playerId, double health, double multiplier)
+    : unitId(unitId)
+    , playerId(playerId)
+    , health(health)
+    , multiplier(multiplier) {
+}
+
+void ScoreAccumulator::add(const DamageEvent& event, int eventUnitPlayerId) {
+    double eventScore = event.damage * discount(event.tick);
+
+    if (eventScore < 0 && event.unitId == unitId) {
+        eventScore = -std::min(100 - health, 50.0);
+    } else if (!event.real) {
+        eventScore *= std::min(event.probability, 1.0);
+    }
+    if (event.unitId == unitId) {
+        eventScore = multiplier * eventScore;
+        realHits = realHits || event.real;
+    } else if (eventUnitPlayerId == playerId) {
+        eventScore = 0;
+    }
+    score += eventScore;
+}
+
+bool ScoreAccumulator::isActive() const {
+    return unitId >= 0;
+}
+
+double ScoreAccumulator::getScore() const {
+    return score;
+}
+
+bool ScoreAccumulator::hasRealHits() const {
+    return realHits;
+}
+
+double ScoreAccumulator::discount(int tick) {
+    // Filled by repeated multiplication, so the values match the old per event loop bit for bit
+    static const std::array<double, 128> table = [] {
+        std::array<double, 128> result{};
+        double value = 1.0;
+        for (double& item : result) {
+            item = value;
+            value *= 0.9;
+        }
+        return result;
+    }();
+    if (tick < table.size()) {
+        return table[tick];
+    }
+    return std::pow(0.9, tick);
+}
@@ -2,11 +2,67 @@
 #define _SIMULATION_HPP_
 
 
+#include <array>
+#include <bitset>
 #include "model/Game.hpp"
 #include "model/UnitAction.hpp"
 #include "Debug.hpp"
 #include "Util.hpp"
 
+// Rays on each side of the aim in a fan of virtual bullets
+constexpr int HIT_RAYS_PER_SIDE = 12;
+constexpr int MAX_HIT_UNITS = 8;
+
+// One bit per ray of a virtual bullet fan, set when the ray hits the unit
+using HitMask = std::bitset<2 * HIT_RAYS_PER_SIDE + 1>;
+
+// Hit masks of the units, in the order of Game::units, for every enemy scenario of a shot.
+struct HitMatrix {
+    static constexpr int MAX_SCENARIOS = 4;
+
+    std::array<std::array<HitMask, MAX_HIT_UNITS>, MAX_SCENARIOS> masks{};
+    int scenariosCount = 0;
+    int unitsCount = 0;
+};
+
+// Actions of the units moving in a simulated tick, in the order they were first set. Units without an action don't
+// move. Fixed capacity, the planner fills one per simulation step without touching the heap.
+class TickActions {
+public:
+    void set(int unitId, const UnitAction& action);
+
+    const std::pair<int, UnitAction>* begin() const { return actions.data(); }
+    const std::pair<int, UnitAction>* end() const { return actions.data() + count; }
+
+private:
+    std::array<std::pair<int, UnitAction>, MAX_HIT_UNITS> actions;
+    int count = 0;
+};
+
+// Discounted, probability weighted score of the damage events from the point of view of one unit.
+// Simulation feeds it every emitted event, so comparing two simulations doesn't need their event lists.
+class ScoreAccumulator {
+public:
+    ScoreAccumulator() = default;
+    ScoreAccumulator(int unitId, int playerId, double health, double multiplier);
+
+    void add(const DamageEvent& event, int eventUnitPlayerId);
+
+    bool isActive() const;
+    double getScore() const;
+    bool hasRealHits() const;
+
+    static double discount(int tick);
+
+private:
+    int unitId = -1;
+    int playerId = -1;
+    double health = 0.0;
+    double multiplier = 1.0;
+    double score = 0.0;
+    bool realHits = false;
+};
+
 class Simulation {
 public:
     explicit Simulation(
@@ -21,8 +77,13 @@ public:
         bool calcHitProbability = false
     );
 
+    void simulate(const TickActions& actions, std::optional<int> microTicks = std::nullopt, bool simSuicide = false);
+    // Units move in the iteration order of the map
     void simulate(const std::unordered_map<int, UnitAction>& actions, std::optional<int> microTicks = std::nullopt, bool simSuicide = false);
 
+    // Scores the events for the given unit while simulating. Without recordEvents the event list stays empty
+    void trackScore(const Unit& unit, double multiplier, bool recordEvents);
+
 private:
     void move(const UnitAction& action, int unitId);
     void moveX(const UnitAction& action, int unitId);
@@ -37,6 +98,8 @@ private:
 
     void explode(const Bullet& bullet, std::optional<int> unitId);
 
+    void addEvent(const DamageEvent& event);
+
     double calculateHitProbability(const Bullet& bullet, const Unit& targetUnit, double& angle, double& rawProb, bool explosion = false);
 
     void simulateShoot(const UnitAction& action, int unitId);
@@ -50,7 +113,8 @@ public:
     ColorFloat color;
     std::vector<Bullet> bullets;
     std::unordered_map<int, Unit> units;
-    std::unordered_map<int, std::vector<bool>> bulletHits;
+    std::unordered_map<int, HitMask> bulletHits;
+    ScoreAccumulator score;
 private:
     int startTick;
     int microTicks;
@@ -61,6 +125,7 @@ private:
     bool simBullets;
     bool simShoot;
     bool calcHitProbability;
+    bool recordEvents;
     int myPlayerId;
 };
 
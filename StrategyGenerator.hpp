@@ -2,27 +2,188 @@
 #define _STRATEGYGENERATOR_HPP_
 
 
+#include <array>
+#include <stdexcept>
 #include <vector>
 #include <unordered_map>
 #include "model/UnitAction.hpp"
 #include "model/Unit.hpp"
 
 struct ActionChain {
+    int actionsCount = 0;
+    double move = 0.0;
+    bool jump = false;
+    bool jumpDown = false;
+    bool shoot = true;
+
+    constexpr bool sameAction(const ActionChain& other) const {
+        return move == other.move && jump == other.jump && jumpDown == other.jumpDown && shoot == other.shoot;
+    }
+
+    constexpr ActionChain withCount(int count) const {
+        return ActionChain{count, move, jump, jumpDown, shoot};
+    }
+};
+
+// Action sequence stored as consecutive ActionChain segments. The action of a tick is built on demand,
+// so sequences are cheap to copy, cut and extend and never allocate.
+class ActionSequence {
+public:
+    static constexpr int MAX_SEGMENTS = 8;
+
+    constexpr ActionSequence() : segments(), segmentsCount(0), actionsCount(0) {}
+
+    constexpr explicit ActionSequence(const ActionChain& chain) : ActionSequence() {
+        append(chain);
+    }
+
+    constexpr ActionSequence& append(const ActionChain& chain) {
+        if (chain.actionsCount <= 0) {
+            return *this;
+        }
+        if (segmentsCount > 0 && segments[segmentsCount - 1].sameAction(chain)) {
+            segments[segmentsCount - 1].actionsCount += chain.actionsCount;
+        } else if (segmentsCount < MAX_SEGMENTS) {
+            segments[segmentsCount++] = chain;
+        } else {
+            throw std::length_error("ActionSequence: too many segments");
+        }
+        actionsCount += chain.actionsCount;
+        return *this;
+    }
+
+    constexpr ActionSequence then(const ActionChain& chain) const {
+        ActionSequence result = *this;
+        result.append(chain);
+        return result;
+    }
+
+    // First count ticks of the sequence
+    constexpr ActionSequence prefix(int count) const {
+        ActionSequence result;
+        for (int i = 0; i < segmentsCount && count > 0; ++i) {
+            int taken = segments[i].actionsCount < count ? segments[i].actionsCount : count;
+            result.append(segments[i].withCount(taken));
+            count -= taken;
+        }
+        return result;
+    }
+
+    // The same sequence one tick later: the first action is dropped and the last one is repeated
+    constexpr ActionSequence shifted() const {
+        ActionSequence result;
+        int skipped = 1;
+        for (int i = 0; i < segmentsCount; ++i) {
+            int dropped = segments[i].actionsCount < skipped ? segments[i].actionsCount : skipped;
+            result.append(segments[i].withCount(segments[i].actionsCount - dropped));
+            skipped -= dropped;
+        }
+        if (segmentsCount > 0) {
+            result.append(segments[segmentsCount - 1].withCount(1));
+        }
+        return result;
+    }
+
+    constexpr int size() const {
+        return actionsCount;
+    }
+
+    constexpr bool empty() const {
+        return actionsCount == 0;
+    }
+
+    constexpr bool isConstant() const {
+        return segmentsCount <= 1;
+    }
+
+    // Segment the tick belongs to, ticks after the end belong to the last one
+    constexpr const ActionChain& chainAt(int tick) const {
+        for (int i = 0; i < segmentsCount - 1; ++i) {
+            if (tick < segments[i].actionsCount) {
+                return segments[i];
+            }
+            tick -= segments[i].actionsCount;
+        }
+        return segments[segmentsCount - 1];
+    }
+
+    UnitAction operator[](int tick) const;
+
+private:
+    std::array<ActionChain, MAX_SEGMENTS> segments;
+    int segmentsCount;
     int actionsCount;
-    double move;
-    bool jump;
-    bool jumpDown;
 };
 
 class StrategyGenerator {
 public:
-    static std::vector<UnitAction> getActions(int actionsCount, double move, bool jump, bool jumpDown, bool shoot = true);
+    static UnitAction getAction(const ActionChain& actionChain);
+    static UnitAction getAction(double move, bool jump, bool jumpDown, bool shoot = true);
+
+    // Constant move/jump combinations the planner chooses from. Jumps go first and are skipped when the unit can't jump
+    static constexpr std::array<ActionChain, 9> PRIMITIVE_CHAINS = {{
+        {1, 1, true, false},
+        {1, 0, true, false},
+        {1, -1, true, false},
+        {1, 1, false, false},
+        {1, 0, false, false},
+        {1, -1, false, false},
+        {1, 1, false, true},
+        {1, 0, false, true},
+        {1, -1, false, true}
+    }};
+
+    static constexpr int firstPrimitive(bool canJump) {
+        return canJump ? 0 : 3;
+    }
 
-    static std::vector<UnitAction> getActions(int actionsCount, double move, bool jump, bool jumpDown,
-                                              std::vector<UnitAction> tailActions);
+    // Moves tried from every tile when looking for the path distance from a position outside of the path graph
+    static constexpr std::array<ActionChain, 16> PATH_MOVES = {{
+        {1, 1, true, false},
+        {1, 0.5, true, false},
+        {1, 0.25, true, false},
+        {1, 0.1, true, false},
+        {1, 0, true, false},
+        {1, -0.1, true, false},
+        {1, -0.25, true, false},
+        {1, -0.5, true, false},
+        {1, -1, true, false},
+        {1, 1, false, true},
+        {1, 0.25, false, true},
+        {1, 0, false, true},
+        {1, -0.25, false, true},
+        {1, -1, false, true},
+        {1, 1, false, false},
+        {1, -1, false, false}
+    }};
 
-    static std::vector<UnitAction> getActions(ActionChain actionChain);
-    static std::vector<UnitAction> getActions(std::vector<ActionChain> actionChains);
+    // Sequences used to connect the tiles of the path graph
+    static constexpr std::array<ActionSequence, 24> PATH_GRAPH_SEQUENCES = {{
+        ActionSequence({1, 1, true, false}),
+        ActionSequence({1, 0.5, true, false}),
+        ActionSequence({1, 0.25, true, false}),
+        ActionSequence({1, 0.1, true, false}),
+        ActionSequence({1, 0, true, false}),
+        ActionSequence({1, -0.1, true, false}),
+        ActionSequence({1, -0.25, true, false}),
+        ActionSequence({1, -0.5, true, false}),
+        ActionSequence({1, -1, true, false}),
+        ActionSequence({1, 1, false, true}),
+        ActionSequence({1, 0.25, false, true}),
+        ActionSequence({1, 0.1, false, true}),
+        ActionSequence({1, 0, false, true}),
+        ActionSequence({1, -0.1, false, true}),
+        ActionSequence({1, -0.25, false, true}),
+        ActionSequence({1, -1, false, true}),
+        ActionSequence({1, 1, false, false}),
+        ActionSequence({1, -1, false, false}),
+        ActionSequence({6, 1, false, true}).then({1, 0, false, true}),
+        ActionSequence({6, -1, false, true}).then({1, 0, false, true}),
+        ActionSequence({9, 1, true, false}).then({9, 1, false, true}),
+        ActionSequence({9, -1, true, false}).then({9, -1, false, true}),
+        ActionSequence({6, 0, true, false}).then({3, 1, true, false}).then({9, 1, false, true}),
+        ActionSequence({6, 0, true, false}).then({3, -1, true, false}).then({9, -1, false, true})
+    }};
 };
 
 
@@ -13,6 +13,11 @@ bool isLittleEndianMachine() {
 
 bool IS_LITTLE_ENDIAN_MACHINE = isLittleEndianMachine();
 
+size_t InputStream::readSome(char *buffer, size_t maxCount) {
+  readBytes(buffer, 1);
+  return 1;
+}
+
 bool InputStream::readBool() {
   char buffer[1];
   readBytes(buffer, 1);
@@ -6,6 +6,9 @@
 class InputStream {
 public:
   virtual void readBytes(char *buffer, size_t byteCount) = 0;
+  // Reads at least one and at most maxCount bytes, blocks only if nothing
+  // has arrived yet
+  virtual size_t readSome(char *buffer, size_t maxCount);
   bool readBool();
   int readInt();
   long long readLongLong();
@@ -26,4 +29,12 @@ public:
   void write(const std::string &value);
 };
 
+// Drops everything written, e.g. the debug drawings of a game without a
+// server
+class NullOutputStream : public OutputStream {
+public:
+  void writeBytes(const char *, size_t) override {}
+  void flush() override {}
+};
+
 #endif
\ No newline at end of file
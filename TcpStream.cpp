@@ -1,4 +1,5 @@
 #include "TcpStream.hpp"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
@@ -40,6 +41,8 @@ TcpStream::TcpStream(const std::string &host, int port) {
   freeaddrinfo(servinfo);
 }
 
+TcpStream::TcpStream(SOCKET sock) : sock(sock) {}
+
 class TcpInputStream : public InputStream {
 public:
   TcpInputStream(std::shared_ptr<TcpStream> tcpStream)
@@ -65,13 +68,28 @@ public:
       RECV_SEND_T received =
           recv(tcpStream->sock, this->buffer + bufferPos + bufferSize,
                BUFFER_CAPACITY - bufferPos - bufferSize, 0);
-      if (received < 0) {
+      if (received <= 0) {
         throw std::runtime_error("Failed to read from socket");
       }
       bufferSize += received;
     }
   }
 
+  size_t readSome(char *buffer, size_t maxCount) {
+    if (bufferSize > 0) {
+      size_t count = std::min(bufferSize, maxCount);
+      memcpy(buffer, this->buffer + bufferPos, count);
+      bufferPos += count;
+      bufferSize -= count;
+      return count;
+    }
+    RECV_SEND_T received = recv(tcpStream->sock, buffer, maxCount, 0);
+    if (received <= 0) {
+      throw std::runtime_error("Failed to read from socket");
+    }
+    return received;
+  }
+
 private:
   static const size_t BUFFER_CAPACITY = 8 * 1024;
   char buffer[BUFFER_CAPACITY];
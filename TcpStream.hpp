@@ -23,6 +23,8 @@ typedef int SOCKET;
 class TcpStream {
 public:
   TcpStream(const std::string &host, int port);
+  // Takes over a connected stream socket, e.g. one accepted by a server
+  explicit TcpStream(SOCKET sock);
   SOCKET sock;
 };
 
@@ -0,0 +1,126 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace {
+// Pool and index of the deque owned by the current thread, threads outside of a pool share its deque 0.
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local int currentQueueIndex = 0;
+}
+
+ThreadPool::ThreadPool(int threadsCount) : queuedJobs(0), stopping(false) {
+    threadsCount = std::max(1, threadsCount);
+    for (int i = 0; i < threadsCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threadsCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const {
+    return int(queues.size());
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    Batch batch;
+    batch.task = &task;
+    batch.pending = count;
+
+    int queueIndex = currentPool == this ? currentQueueIndex : 0;
+    for (int i = 0; i < count; ++i) {
+        Queue& queue = *queues[(queueIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{&batch, i});
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedJobs += count;
+    }
+    wakeUp.notify_all();
+
+    Job job;
+    while (batch.pending > 0) {
+        if (popJob(queueIndex, job)) {
+            runJob(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void ThreadPool::workerLoop(int queueIndex) {
+    currentPool = this;
+    currentQueueIndex = queueIndex;
+    Job job;
+    while (true) {
+        if (popJob(queueIndex, job)) {
+            runJob(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stopping || queuedJobs > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popJob(int queueIndex, Job& job) {
+    {
+        Queue& own = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            --queuedJobs;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(queueIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            --queuedJobs;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runJob(const Job& job) {
+    try {
+        (*job.batch->task)(job.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(job.batch->errorMutex);
+        if (!job.batch->error) {
+            job.batch->error = std::current_exception();
+        }
+    }
+    --job.batch->pending;
+}
@@ -0,0 +1,62 @@
+#ifndef _THREADPOOL_HPP_
+#define _THREADPOOL_HPP_
+
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent work-stealing pool. Every worker owns a deque, pops its own jobs from the back
+// and steals from the front of the other deques. The thread calling parallelFor helps to execute
+// jobs while it waits, so nested parallelFor calls from inside a job never deadlock.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadsCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const;
+
+    // Runs task(i) for every i in [0, count) and returns when all of them are finished.
+    // Results must be written to per-index slots, the order of execution is not specified.
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    struct Batch {
+        const std::function<void(int)>* task;
+        std::atomic<int> pending;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+
+    struct Job {
+        Batch* batch;
+        int index;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(int queueIndex);
+    bool popJob(int queueIndex, Job& job);
+    void runJob(const Job& job);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queuedJobs;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+};
+
+#endif
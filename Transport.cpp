@@ -0,0 +1,55 @@
+#include "Transport.hpp"
+#include "SharedMemoryStream.hpp"
+#include "TcpStream.hpp"
+#include <cstring>
+#include <stdexcept>
+#ifndef _WIN32
+#include <sys/un.h>
+#endif
+
+namespace {
+
+bool startsWith(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+#ifndef _WIN32
+std::shared_ptr<TcpStream> connectUnixSocket(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    SOCKET sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1) {
+        throw std::runtime_error("Failed to create socket");
+    }
+    if (connect(sock, (sockaddr *)&address, sizeof(address)) == -1) {
+        close(sock);
+        throw std::runtime_error("Failed to connect to " + path);
+    }
+    // The stream reads and writes a socket regardless of its family
+    return std::make_shared<TcpStream>(sock);
+}
+#endif
+
+}
+
+Transport connectTransport(const std::string& host, int port) {
+    if (startsWith(host, "unix:")) {
+#ifndef _WIN32
+        auto stream = connectUnixSocket(host.substr(5));
+        return {getInputStream(stream), getOutputStream(stream)};
+#else
+        throw std::runtime_error("Unix sockets are not supported on Windows");
+#endif
+    }
+    if (startsWith(host, "shm:")) {
+        auto channel = SharedMemoryChannel::open(host.substr(4));
+        return {channel->getInputStream(), channel->getOutputStream()};
+    }
+    auto stream = std::make_shared<TcpStream>(host, port);
+    return {getInputStream(stream), getOutputStream(stream)};
+}
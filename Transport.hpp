@@ -0,0 +1,19 @@
+#ifndef _TRANSPORT_HPP_
+#define _TRANSPORT_HPP_
+
+
+#include <memory>
+#include <string>
+#include "Stream.hpp"
+
+// Streams of a connection to the server. They keep the underlying socket or channel alive.
+struct Transport {
+    std::shared_ptr<InputStream> inputStream;
+    std::shared_ptr<OutputStream> outputStream;
+};
+
+// Connects to the server by the host argument: "unix:<path>" is a Unix domain socket, "shm:<name>" a shared memory
+// channel created by the server (Linux only), anything else a TCP host with the port.
+Transport connectTransport(const std::string& host, int port);
+
+#endif
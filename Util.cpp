@@ -1,5 +1,6 @@
 #include <unordered_set>
 #include "Util.hpp"
+#include "AngleMath.hpp"
 #include "model/Tile.hpp"
 
 
@@ -68,7 +69,7 @@ double length(const Vec2Double& a) {
 }
 
 double findAngle(const Vec2Double& a, const Vec2Double& b) {
-    return acos((a.x * b.x + a.y * b.y) / (length(a) * length(b)));
+    return angleBetween(a, b);
 }
 
 double findAngle(double a, double b) {
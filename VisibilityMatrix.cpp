@@ -0,0 +1,112 @@
+#include "VisibilityMatrix.hpp"
+#include <algorithm>
+#include <cmath>
+
+void VisibilityMatrix::build(const Level& level, ThreadPool& threadPool) {
+    width = level.tiles.size();
+    height = width == 0 ? 0 : level.tiles[0].size();
+    int tilesCount = width * height;
+    rowWords = (tilesCount + 63) / 64;
+    bits.assign(size_t(tilesCount) * rowWords, 0);
+    walls.resize(tilesCount);
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y) {
+            walls[x * height + y] = level.tiles[x][y] == WALL;
+        }
+    }
+
+    // Lines are symmetric, so every job traces the tiles after its own one and the lower half is mirrored
+    // afterwards. Every row is written by one job only.
+    threadPool.parallelFor(tilesCount, [&](int from) {
+        int x1 = from / height;
+        int y1 = from % height;
+        uint64_t* row = &bits[size_t(from) * rowWords];
+        for (int to = from; to < tilesCount; ++to) {
+            if (traceLine(x1, y1, to / height, to % height)) {
+                row[to / 64] |= uint64_t(1) << (to % 64);
+            }
+        }
+    });
+    for (int from = 0; from < tilesCount; ++from) {
+        for (int to = 0; to < from; ++to) {
+            if (isVisible(to / height, to % height, from / height, from % height)) {
+                bits[size_t(from) * rowWords + to / 64] |= uint64_t(1) << (to % 64);
+            }
+        }
+    }
+}
+
+bool VisibilityMatrix::isBuilt() const {
+    return !bits.empty();
+}
+
+bool VisibilityMatrix::isVisible(int x1, int y1, int x2, int y2) const {
+    int to = x2 * height + y2;
+    return (bits[size_t(x1 * height + y1) * rowWords + to / 64] >> (to % 64)) & 1;
+}
+
+bool VisibilityMatrix::isUnitVisible(const Vec2Double& from, const Unit& unit, double margin) const {
+    int fromX = int(from.x);
+    int fromY = int(from.y);
+    int left = std::max(0, int(unit.position.x - unit.size.x / 2 - margin));
+    int right = std::min(width - 1, int(unit.position.x + unit.size.x / 2 + margin));
+    int bottom = std::max(0, int(unit.position.y - margin));
+    int top = std::min(height - 1, int(unit.position.y + unit.size.y + margin));
+    for (int x = std::max(0, fromX - 1); x <= std::min(width - 1, fromX + 1); ++x) {
+        for (int y = std::max(0, fromY - 1); y <= std::min(height - 1, fromY + 1); ++y) {
+            if (isWall(x, y)) {
+                continue;
+            }
+            for (int tx = left; tx <= right; ++tx) {
+                for (int ty = bottom; ty <= top; ++ty) {
+                    if (isVisible(x, y, tx, ty)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool VisibilityMatrix::isWall(int x, int y) const {
+    return walls[x * height + y];
+}
+
+bool VisibilityMatrix::traceLine(int x1, int y1, int x2, int y2) const {
+    // Walks the tiles the line between the centers crosses. Crossing exactly through a corner touches
+    // both tiles next to it, a bullet isn't thin enough to squeeze between them.
+    int x = x1;
+    int y = y1;
+    int stepX = x2 > x1 ? 1 : -1;
+    int stepY = y2 > y1 ? 1 : -1;
+    int dx = std::abs(x2 - x1);
+    int dy = std::abs(y2 - y1);
+    // Line parameters of the next vertical and horizontal tile borders, scaled by 2 * dx * dy to stay in integers
+    long long nextX = dx == 0 ? -1 : (long long)dy;
+    long long nextY = dy == 0 ? -1 : (long long)dx;
+    if (isWall(x, y)) {
+        return false;
+    }
+    while (x != x2 || y != y2) {
+        if (dy == 0 || (dx != 0 && nextX < nextY)) {
+            x += stepX;
+            nextX += 2 * dy;
+        } else if (dx == 0 || nextY < nextX) {
+            y += stepY;
+            nextY += 2 * dx;
+        } else {
+            if (isWall(x + stepX, y) || isWall(x, y + stepY)) {
+                return false;
+            }
+            x += stepX;
+            y += stepY;
+            nextX += 2 * dy;
+            nextY += 2 * dx;
+        }
+        if (isWall(x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef _VISIBILITYMATRIX_HPP_
+#define _VISIBILITYMATRIX_HPP_
+
+
+#include <cstdint>
+#include <vector>
+#include "model/Game.hpp"
+#include "ThreadPool.hpp"
+
+// Line of sight between the centers of every pair of tiles of a level, one bit per pair. Only walls block it,
+// bullets fly through platforms, ladders and jump pads. Built once per level.
+class VisibilityMatrix {
+public:
+    void build(const Level& level, ThreadPool& threadPool);
+
+    bool isBuilt() const;
+
+    bool isVisible(int x1, int y1, int x2, int y2) const;
+
+    // Conservative test for shots from the point: false only when every line from the tile of the point or one of
+    // its neighbours to any tile the unit box grown by margin covers is blocked. The neighbours stand for the exact
+    // point within its tile and the unit height, the margin for the bullet size, explosions and the target moving.
+    bool isUnitVisible(const Vec2Double& from, const Unit& unit, double margin) const;
+
+private:
+    bool isWall(int x, int y) const;
+    bool traceLine(int x1, int y1, int x2, int y2) const;
+
+    int width = 0;
+    int height = 0;
+    int rowWords = 0;
+    std::vector<uint64_t> bits;
+    std::vector<uint8_t> walls;
+};
+
+#endif
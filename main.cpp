@@ -1,56 +1,227 @@
 #include "Debug.hpp"
+#include "GameRecorder.hpp"
+#include "Logger.hpp"
+#include "MessageReader.hpp"
 #include "MyStrategy.hpp"
-#include "TcpStream.hpp"
+#include "Transport.hpp"
 #include "model/PlayerMessageGame.hpp"
-#include "model/ServerMessageGame.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include <cstdlib>
 #include <iostream>
 
 class Runner {
 public:
-  Runner(const std::string &host, int port, const std::string &token) {
-    std::shared_ptr<TcpStream> tcpStream(new TcpStream(host, port));
-    inputStream = getInputStream(tcpStream);
-    outputStream = getOutputStream(tcpStream);
+  Runner(const std::string &host, int port, const std::string &token,
+         int threadsCount, const PlannerConfig &plannerConfig,
+         bool parallelUnits, bool speculate, const std::string &recordPath)
+      : threadsCount(threadsCount), plannerConfig(plannerConfig),
+        parallelUnits(parallelUnits), speculate(speculate) {
+    Transport transport = connectTransport(host, port);
+    inputStream = transport.inputStream;
+    outputStream = transport.outputStream;
     outputStream->write(token);
     outputStream->flush();
+    if (!recordPath.empty()) {
+      recorder = std::make_unique<GameRecorder>(recordPath);
+      recordedOutput = std::make_shared<TeeOutputStream>(outputStream);
+      outputStream = recordedOutput;
+    }
+  }
+  ~Runner() {
+    if (speculationWorker.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        speculationCancelled = true;
+        speculationWorkerStopping = true;
+        speculationSignal.notify_all();
+      }
+      speculationWorker.join();
+    }
   }
+
   void run() {
-    MyStrategy myStrategy;
+    MyStrategy myStrategy(threadsCount, plannerConfig);
     Debug debug(outputStream);
-    while (true) {
-      auto message = ServerMessageGame::readFrom(*inputStream);
-      const auto& playerView = message.playerView;
-      if (!playerView) {
-        break;
+    MessageReader messageReader(inputStream);
+    PlayerView playerView;
+    while (messageReader.readServerMessage(playerView)) {
+      stopSpeculation();
+      if (recorder) {
+        recorder->recordServerMessage(playerView.game.currentTick,
+                                      messageReader.lastMessageData(),
+                                      messageReader.lastMessageSize());
       }
       std::unordered_map<int, UnitAction> actions;
-      for (const Unit &unit : playerView->game.units) {
-        if (unit.playerId == playerView->myId) {
-          actions.emplace(std::make_pair(
-              unit.id,
-              myStrategy.getAction(unit, playerView->game, debug)));
-        }
+      if (parallelUnits) {
+        actions = getActionsInParallel(myStrategy, playerView, debug);
+      } else {
+        actions = myStrategy.getActions(playerView, debug);
       }
+      // The runner attributes drawings to the tick until it gets the actions,
+      // both go out in one send
+      debug.writePending();
       PlayerMessageGame::ActionMessage(Versioned(actions)).writeTo(*outputStream);
       outputStream->flush();
+      if (speculate) {
+        startSpeculation(myStrategy, playerView, actions);
+      }
+      if (recorder) {
+        const std::vector<char> &sent = recordedOutput->getBytes();
+        recorder->recordPlayerMessages(playerView.game.currentTick,
+                                       sent.data(), sent.size());
+        recordedOutput->clearBytes();
+      }
+    }
+    stopSpeculation();
+    if (recorder) {
+      recorder->recordServerMessage(-1, messageReader.lastMessageData(),
+                                    messageReader.lastMessageSize());
     }
   }
 
 private:
+  // The strategy predicts the next tick on a background thread until the
+  // server sends it. The thread is started once and waits for the tick to
+  // predict, every tick is handed over and cancelled under speculationMutex.
+  void startSpeculation(MyStrategy &myStrategy, const PlayerView &playerView,
+                        const std::unordered_map<int, UnitAction> &actions) {
+    std::lock_guard<std::mutex> lock(speculationMutex);
+    speculationStrategy = &myStrategy;
+    speculationView = playerView;
+    speculationActions = actions;
+    speculationCancelled = false;
+    speculationPending = true;
+    if (!speculationWorker.joinable()) {
+      speculationWorker = std::thread([this]() { runSpeculations(); });
+    }
+    speculationSignal.notify_all();
+  }
+
+  // Cancels the prediction of the tick and waits until the worker leaves it
+  void stopSpeculation() {
+    std::unique_lock<std::mutex> lock(speculationMutex);
+    if (!speculationPending) {
+      return;
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    speculationCancelled = true;
+    speculationSignal.wait(lock, [this]() { return !speculationPending; });
+    MyStrategy::addPerf("speculationWait", t1);
+  }
+
+  void runSpeculations() {
+    std::unique_lock<std::mutex> lock(speculationMutex);
+    while (true) {
+      speculationSignal.wait(lock, [this]() {
+        return speculationPending || speculationWorkerStopping;
+      });
+      if (speculationWorkerStopping) {
+        return;
+      }
+      // The slots aren't touched until speculationPending is cleared
+      lock.unlock();
+      // Drawings of the predicted tick go nowhere
+      Debug debug(std::make_shared<NullOutputStream>());
+      try {
+        speculationStrategy->speculate(speculationView, speculationActions,
+                                       debug, speculationCancelled);
+      } catch (const std::exception &e) {
+        LOG(WARN) << "Speculation failed: " << e.what();
+      }
+      lock.lock();
+      speculationPending = false;
+      speculationSignal.notify_all();
+    }
+  }
+
+  // Plans every unit on its own worker, the units only see each other's
+  // plans from the previous tick
+  std::unordered_map<int, UnitAction>
+  getActionsInParallel(MyStrategy &myStrategy, const PlayerView &playerView,
+                       Debug &debug) {
+    const Game &game = playerView.game;
+    if (!unitWorkers) {
+      unitWorkers =
+          std::make_unique<ThreadPool>(game.properties.teamSize);
+    }
+    myStrategy.prepareTick(game, playerView.myId, debug);
+    std::vector<const Unit *> myUnits;
+    for (const Unit &unit : game.units) {
+      if (unit.playerId == playerView.myId) {
+        myUnits.push_back(&unit);
+      }
+    }
+    std::vector<UnitAction> unitActions(myUnits.size());
+    unitWorkers->parallelFor(myUnits.size(), [&](int i) {
+      unitActions[i] = myStrategy.getAction(*myUnits[i], game, debug);
+    });
+    std::unordered_map<int, UnitAction> actions;
+    for (size_t i = 0; i < myUnits.size(); ++i) {
+      actions.emplace(myUnits[i]->id, unitActions[i]);
+    }
+    return actions;
+  }
+
   std::shared_ptr<InputStream> inputStream;
   std::shared_ptr<OutputStream> outputStream;
+  int threadsCount;
+  PlannerConfig plannerConfig;
+  bool parallelUnits;
+  bool speculate;
+  std::thread speculationWorker;
+  std::mutex speculationMutex;
+  std::condition_variable speculationSignal;
+  // The tick handed to the worker, valid while speculationPending is set
+  MyStrategy *speculationStrategy = nullptr;
+  PlayerView speculationView;
+  std::unordered_map<int, UnitAction> speculationActions;
+  bool speculationPending = false;
+  bool speculationWorkerStopping = false;
+  std::atomic<bool> speculationCancelled;
+  std::unique_ptr<ThreadPool> unitWorkers;
+  std::unique_ptr<GameRecorder> recorder;
+  std::shared_ptr<TeeOutputStream> recordedOutput;
 };
 
 int main(int argc, char *argv[]) {
   std::string host = argc < 2 ? "127.0.0.1" : argv[1];
   int port = argc < 3 ? 31001 : atoi(argv[2]);
   std::string token = argc < 4 ? "0000000000000000" : argv[3];
-  Runner(host, port, token).run();
+  const char *threads = std::getenv("AICUP_THREADS");
+  int threadsCount = threads == nullptr ? 1 : atoi(threads);
+  PlannerConfig plannerConfig = PlannerConfig::fromEnvironment();
+  const char *logLevel = std::getenv("AICUP_LOG_LEVEL");
+  const char *logFile = std::getenv("AICUP_LOG_FILE");
+  Logger::start(Logger::parseLevel(logLevel == nullptr ? "" : logLevel,
+                                   LogLevel::INFO),
+                logFile == nullptr ? "" : logFile);
+  const char *parallelUnits = std::getenv("AICUP_PARALLEL_UNITS");
+  const char *recordFile = std::getenv("AICUP_RECORD_FILE");
+  const char *speculate = std::getenv("AICUP_SPECULATE");
+  Runner(host, port, token, threadsCount, plannerConfig,
+         parallelUnits != nullptr && atoi(parallelUnits) != 0,
+         speculate != nullptr && atoi(speculate) != 0,
+         recordFile == nullptr ? "" : recordFile)
+      .run();
+  Logger::stop();
+  MyStrategy::mergePerf();
   for (const auto&[key, value] : MyStrategy::PERF) {
     std::cerr << key << ": " << value << " ms\n";
   }
+  for (const auto&[key, value] : MyStrategy::COUNTERS) {
+    std::cerr << key << ": " << value << "\n";
+  }
+  auto plannedTicks = MyStrategy::COUNTERS.find("plannedTicks");
+  if (plannedTicks != MyStrategy::COUNTERS.end() && plannedTicks->second > 0) {
+    std::cerr << "pruned ticks ratio: "
+              << double(MyStrategy::COUNTERS["prunedTicks"]) / plannedTicks->second << "\n";
+  }
   return 0;
 }
\ No newline at end of file
@@ -4,6 +4,9 @@ Versioned::Versioned() { }
 Versioned::Versioned(std::unordered_map<int, UnitAction> inner) : inner(inner) { }
 Versioned Versioned::readFrom(InputStream& stream) {
     Versioned result;
+    if (stream.readInt() != 43981) {
+        throw std::runtime_error("Unexpected Versioned magic");
+    }
     size_t innerSize = stream.readInt();
     result.inner = std::unordered_map<int, UnitAction>();
     result.inner.reserve(innerSize);
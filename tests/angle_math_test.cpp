@@ -0,0 +1,125 @@
+// Error bounds of AngleMath against libm: the scalar and the batched fastAtan2, angleBetween and fanDirections.
+#include "../AngleMath.hpp"
+#include "../Simulation.hpp"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Documented in AngleMath.hpp
+constexpr double ATAN2_BOUND = 1e-13;
+// A few ulps of the unit vector components, the fans of the game rotate by up to HIT_RAYS_PER_SIDE steps
+constexpr double FAN_BOUND = 8 * DBL_EPSILON;
+
+int failures = 0;
+
+void check(bool condition, const char* what, double a, double b) {
+    if (!condition) {
+        ++failures;
+        if (failures <= 20) {
+            std::printf("FAILED %s: %.17g %.17g\n", what, a, b);
+        }
+    }
+}
+
+void checkAtan2(double y, double x) {
+    double expected = std::atan2(y, x);
+    double actual = fastAtan2(y, x);
+    check(std::fabs(actual - expected) <= ATAN2_BOUND, "fastAtan2", y, x);
+    // The signed zeros of the axes come out like in libm
+    if (expected == 0.0) {
+        check(actual == 0.0 && std::signbit(actual) == std::signbit(expected), "fastAtan2 signed zero", y, x);
+    }
+}
+
+}
+
+int main() {
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> exponent(-30.0, 30.0);
+
+    // Axes and signed zeros
+    for (double y : {0.0, -0.0, 1.0, -1.0, 1e-300, -1e-300, 1e300, -1e300}) {
+        for (double x : {0.0, -0.0, 1.0, -1.0, 1e-300, -1e-300, 1e300, -1e300}) {
+            checkAtan2(y, x);
+        }
+    }
+    // Around the reduction boundary t = tan(pi/12) and the octant boundary t = 1 in every quadrant
+    for (double t : {angle_math::TAN_PI_12, 1.0}) {
+        for (int ulps = -64; ulps <= 64; ++ulps) {
+            double value = t;
+            for (int i = 0; i < std::abs(ulps); ++i) {
+                value = std::nextafter(value, ulps < 0 ? 0.0 : 2.0);
+            }
+            for (double sx : {1.0, -1.0}) {
+                for (double sy : {1.0, -1.0}) {
+                    checkAtan2(sy * value, sx);
+                    checkAtan2(sy, sx * value);
+                }
+            }
+        }
+    }
+    // Random points of all magnitudes
+    const int count = 1000000;
+    std::vector<double> ys(count);
+    std::vector<double> xs(count);
+    for (int i = 0; i < count; ++i) {
+        ys[i] = unit(random) * std::pow(10.0, exponent(random));
+        xs[i] = unit(random) * std::pow(10.0, exponent(random));
+        checkAtan2(ys[i], xs[i]);
+    }
+
+    // The batched version against libm
+    std::vector<double> angles(count);
+    fastAtan2(ys.data(), xs.data(), angles.data(), count);
+    for (int i = 0; i < count; ++i) {
+        check(std::fabs(angles[i] - std::atan2(ys[i], xs[i])) <= ATAN2_BOUND, "batched fastAtan2", ys[i], xs[i]);
+    }
+
+    // angleBetween against atan2 of the cross and dot products, and against acos away from 0 and pi where acos
+    // loses precision
+    for (int i = 0; i < count / 10; ++i) {
+        Vec2Double a(unit(random), unit(random));
+        Vec2Double b(unit(random), unit(random));
+        double cross = a.x * b.y - a.y * b.x;
+        double dot = a.x * b.x + a.y * b.y;
+        double angle = angleBetween(a, b);
+        check(std::fabs(angle - std::atan2(std::fabs(cross), dot)) <= ATAN2_BOUND, "angleBetween", a.x, b.x);
+        double cosine = dot / (std::hypot(a.x, a.y) * std::hypot(b.x, b.y));
+        if (std::fabs(cosine) < 0.99) {
+            check(std::fabs(angle - std::acos(cosine)) <= 1e-12, "angleBetween acos", a.x, b.x);
+        }
+    }
+    check(angleBetween(Vec2Double(1, 0), Vec2Double(1, 0)) == 0.0, "angleBetween same", 1, 0);
+    check(std::fabs(angleBetween(Vec2Double(1, 0), Vec2Double(-1, 0)) - angle_math::PI) <= ATAN2_BOUND,
+          "angleBetween opposite", 1, -1);
+
+    // fanDirections against cos and sin of the spread angles
+    std::uniform_real_distribution<double> centerAngle(-angle_math::PI, angle_math::PI);
+    std::uniform_real_distribution<double> spreadAngle(0.0, 1.0);
+    Vec2Double directions[2 * HIT_RAYS_PER_SIDE + 1];
+    for (int i = 0; i < count / 10; ++i) {
+        double center = centerAngle(random);
+        double spread = spreadAngle(random);
+        fanDirections(unitVector(center), spread, HIT_RAYS_PER_SIDE, directions);
+        for (int ray = -HIT_RAYS_PER_SIDE; ray <= HIT_RAYS_PER_SIDE; ++ray) {
+            double rayAngle = center + spread * ray / HIT_RAYS_PER_SIDE;
+            const Vec2Double& direction = directions[ray + HIT_RAYS_PER_SIDE];
+            check(std::fabs(direction.x - std::cos(rayAngle)) <= FAN_BOUND &&
+                  std::fabs(direction.y - std::sin(rayAngle)) <= FAN_BOUND, "fanDirections", center, spread);
+        }
+    }
+    fanDirections(Vec2Double(1, 0), 0.5, 0, directions);
+    check(directions[0].x == 1.0 && directions[0].y == 0.0, "fanDirections without side rays", 1, 0);
+
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
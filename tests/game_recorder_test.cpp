@@ -0,0 +1,89 @@
+// Seeking in game records: through the index of a closed record, by reading the records of a record cut short and of
+// one still being written.
+#include "../GameRecorder.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        ++failures;
+        std::printf("FAILED %s\n", what.c_str());
+    }
+}
+
+// Payload of the server message of the tick, its length differs from tick to tick
+std::string serverMessage(int tick) {
+    return std::string(tick % 7 + 1, char('a' + tick % 26));
+}
+
+void recordTick(GameRecorder& recorder, int tick) {
+    std::string message = serverMessage(tick);
+    recorder.recordServerMessage(tick, message.data(), message.size());
+    std::string reply = "reply" + std::to_string(tick);
+    recorder.recordPlayerMessages(tick, reply.data(), reply.size());
+}
+
+// The whole message, every readSome returns bytes of one message only
+std::string readMessage(RecordInputStream& stream, size_t size) {
+    std::string message(size, 0);
+    stream.readBytes(&message[0], size);
+    return message;
+}
+
+void checkSeeks(const std::string& path, int ticks, const std::string& what) {
+    RecordInputStream stream(path);
+    for (int tick : {ticks - 1, 0, ticks / 2}) {
+        check(stream.seekTick(tick), what + ": seek to tick " + std::to_string(tick));
+        check(readMessage(stream, serverMessage(tick).size()) == serverMessage(tick),
+              what + ": message of tick " + std::to_string(tick));
+    }
+    // A missing tick keeps the position
+    check(!stream.seekTick(1000), what + ": seek to a tick never recorded");
+    int next = ticks / 2 + 1;
+    check(readMessage(stream, serverMessage(next).size()) == serverMessage(next), what + ": message after a failed seek");
+}
+
+}
+
+int main() {
+    std::string path = "/tmp/aicup2019_record_test_" + std::to_string(getpid()) + ".bin";
+    const int ticks = 50;
+    {
+        GameRecorder recorder(path);
+        for (int tick = 0; tick < ticks; ++tick) {
+            recordTick(recorder, tick);
+        }
+        // Every finished tick is on the disk before the recorder closes
+        checkSeeks(path, ticks, "open record");
+        recorder.recordServerMessage(-1, "\0", 1);
+    }
+    checkSeeks(path, ticks, "indexed record");
+
+    // The same record cut in the middle of the last tick has no index
+    std::string cutPath = path + ".cut";
+    {
+        std::ifstream input(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        std::ofstream output(cutPath, std::ios::binary);
+        output.write(bytes.data(), bytes.size() / 2);
+    }
+    RecordInputStream cutStream(cutPath);
+    check(!cutStream.seekTick(ticks - 1), "cut record: seek to a lost tick");
+    checkSeeks(cutPath, ticks / 4, "cut record");
+
+    std::remove(path.c_str());
+    std::remove(cutPath.c_str());
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef _DECISIONCHECKSUM_HPP_
+#define _DECISIONCHECKSUM_HPP_
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../model/UnitAction.hpp"
+
+// FNV-1a over the actions of every tick in the order of the unit ids, equal checksums of two runs mean equal
+// decisions. The doubles are hashed bit by bit, the slightest difference of an aim changes the checksum.
+class DecisionChecksum {
+public:
+    void addTick(const std::unordered_map<int, UnitAction>& actions) {
+        std::vector<std::pair<int, const UnitAction*>> sorted;
+        for (const auto& [unitId, action] : actions) {
+            sorted.emplace_back(unitId, &action);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        add(int(sorted.size()));
+        for (const auto& [unitId, action] : sorted) {
+            add(unitId);
+            add(action->velocity);
+            add(action->aim.x);
+            add(action->aim.y);
+            add(uint8_t(action->jump | action->jumpDown << 1 | action->shoot << 2 | action->reload << 3 |
+                        action->swapWeapon << 4 | action->plantMine << 5));
+        }
+    }
+
+    uint64_t value() const {
+        return hash;
+    }
+
+private:
+    template<typename T>
+    void add(T value) {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes) {
+            hash = (hash ^ byte) * 1099511628211ULL;
+        }
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+};
+
+#endif
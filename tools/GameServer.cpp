@@ -0,0 +1,386 @@
+#include "GameServer.hpp"
+#include "JsonValue.hpp"
+#include "../GameEngine.hpp"
+#include "../model/PlayerMessageGame.hpp"
+#include "../model/ServerMessageGame.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/un.h>
+
+namespace {
+
+std::optional<double> optionalDouble(const JsonValue& object, const std::string& key) {
+    if (!object.has(key) || object[key].isNull()) {
+        return std::nullopt;
+    }
+    return object[key].asDouble();
+}
+
+std::optional<std::string> optionalString(const JsonValue& object, const std::string& key) {
+    if (!object.has(key) || object[key].isNull()) {
+        return std::nullopt;
+    }
+    return object[key].asString();
+}
+
+Vec2Double readVec2Double(const JsonValue& json) {
+    return Vec2Double(json["x"].asDouble(), json["y"].asDouble());
+}
+
+ExplosionParams readExplosionParams(const JsonValue& json) {
+    return ExplosionParams(json["radius"].asDouble(), json["damage"].asInt());
+}
+
+WeaponParams readWeaponParams(const JsonValue& json) {
+    const JsonValue& bullet = json["bullet"];
+    std::shared_ptr<ExplosionParams> explosion;
+    if (json.has("explosion") && !json["explosion"].isNull()) {
+        explosion = std::make_shared<ExplosionParams>(readExplosionParams(json["explosion"]));
+    }
+    return WeaponParams(
+        json["magazine_size"].asInt(),
+        json["fire_rate"].asDouble(),
+        json["reload_time"].asDouble(),
+        json["min_spread"].asDouble(),
+        json["max_spread"].asDouble(),
+        json["recoil"].asDouble(),
+        json["aim_speed"].asDouble(),
+        BulletParams(bullet["speed"].asDouble(), bullet["size"].asDouble(), bullet["damage"].asInt()),
+        explosion
+    );
+}
+
+WeaponType readWeaponType(const std::string& name) {
+    if (name == "Pistol") {
+        return PISTOL;
+    } else if (name == "AssaultRifle") {
+        return ASSAULT_RIFLE;
+    } else if (name == "RocketLauncher") {
+        return ROCKET_LAUNCHER;
+    }
+    throw std::runtime_error("Unknown weapon type " + name);
+}
+
+Properties readProperties(const JsonValue& json) {
+    std::unordered_map<WeaponType, WeaponParams> weaponParams;
+    for (const auto& [name, params] : json["weapon_params"].asObject()) {
+        weaponParams[readWeaponType(name)] = readWeaponParams(params);
+    }
+    return Properties(
+        json["max_tick_count"].asInt(),
+        json["team_size"].asInt(),
+        json["ticks_per_second"].asDouble(),
+        json["updates_per_tick"].asInt(),
+        readVec2Double(json["loot_box_size"]),
+        readVec2Double(json["unit_size"]),
+        json["unit_max_horizontal_speed"].asDouble(),
+        json["unit_fall_speed"].asDouble(),
+        json["unit_jump_time"].asDouble(),
+        json["unit_jump_speed"].asDouble(),
+        json["jump_pad_jump_time"].asDouble(),
+        json["jump_pad_jump_speed"].asDouble(),
+        json["unit_max_health"].asInt(),
+        json["health_pack_health"].asInt(),
+        weaponParams,
+        readVec2Double(json["mine_size"]),
+        readExplosionParams(json["mine_explosion_params"]),
+        json["mine_prepare_time"].asDouble(),
+        json["mine_trigger_time"].asDouble(),
+        json["mine_trigger_radius"].asDouble(),
+        json["kill_score"].asInt()
+    );
+}
+
+std::string readLevel(const JsonValue& json) {
+    if (json.getType() == JsonValue::STRING) {
+        if (json.asString() != "Simple") {
+            throw std::runtime_error("Only the Simple level and levels loaded from files are supported");
+        }
+        return GameEngine::simpleLevel();
+    }
+    return GameEngine::readLevel(json["LoadFrom"]["path"].asString());
+}
+
+PlayerConfig readPlayer(const JsonValue& json) {
+    PlayerConfig player;
+    if (json.getType() == JsonValue::STRING && json.asString() == "Empty") {
+        return player;
+    }
+    if (json.getType() == JsonValue::OBJECT && json.has("Tcp")) {
+        const JsonValue& tcp = json["Tcp"];
+        player.kind = PlayerConfig::TCP;
+        if (auto host = optionalString(tcp, "host")) {
+            player.host = *host;
+        }
+        player.port = tcp["port"].asInt();
+        player.token = optionalString(tcp, "token");
+        player.acceptTimeout = optionalDouble(tcp, "accept_timeout");
+        player.timeout = optionalDouble(tcp, "timeout");
+        return player;
+    }
+    if (json.getType() == JsonValue::OBJECT && json.has("Unix")) {
+        const JsonValue& unixSocket = json["Unix"];
+        player.kind = PlayerConfig::UNIX;
+        player.path = unixSocket["path"].asString();
+        player.token = optionalString(unixSocket, "token");
+        player.acceptTimeout = optionalDouble(unixSocket, "accept_timeout");
+        player.timeout = optionalDouble(unixSocket, "timeout");
+        return player;
+    }
+    if (json.getType() == JsonValue::OBJECT && json.has("SharedMemory")) {
+        const JsonValue& sharedMemory = json["SharedMemory"];
+        player.kind = PlayerConfig::SHARED_MEMORY;
+        player.path = sharedMemory["name"].asString();
+        player.token = optionalString(sharedMemory, "token");
+        player.acceptTimeout = optionalDouble(sharedMemory, "accept_timeout");
+        player.timeout = optionalDouble(sharedMemory, "timeout");
+        return player;
+    }
+    throw std::runtime_error("Unsupported player, the server plays Tcp, Unix, SharedMemory and Empty players");
+}
+
+}
+
+ServerConfig ServerConfig::fromJson(const std::string& text) {
+    JsonValue json = JsonValue::parse(text);
+    const JsonValue& preset = json["options_preset"];
+    if (preset.getType() != JsonValue::OBJECT || !preset.has("Custom")) {
+        throw std::runtime_error("Only the Custom options preset is supported");
+    }
+    ServerConfig config;
+    config.properties = readProperties(preset["Custom"]["properties"]);
+    config.levelText = readLevel(preset["Custom"]["level"]);
+    for (const JsonValue& player : json["players"].asArray()) {
+        config.players.push_back(readPlayer(player));
+    }
+    if (config.players.size() != 2) {
+        throw std::runtime_error("The game is played by two players");
+    }
+    if (json.has("seed") && !json["seed"].isNull()) {
+        config.seed = json["seed"].asInt();
+    } else {
+        config.seed = std::random_device()();
+    }
+    return config;
+}
+
+GameServer::GameServer(ServerConfig config)
+    : config(std::move(config))
+    , connections(this->config.players.size()) {
+}
+
+GameServer::~GameServer() {
+    for (size_t i = 0; i < connections.size(); ++i) {
+        disconnect(connections[i]);
+        if (config.players[i].kind == PlayerConfig::UNIX) {
+            unlink(config.players[i].path.c_str());
+        }
+    }
+}
+
+std::string GameServer::run() {
+    // Everybody listens first, so the clients may connect in any order
+    for (size_t i = 0; i < connections.size(); ++i) {
+        if (config.players[i].kind != PlayerConfig::EMPTY) {
+            listen(config.players[i], connections[i]);
+        }
+    }
+    for (size_t i = 0; i < connections.size(); ++i) {
+        if (config.players[i].kind != PlayerConfig::EMPTY) {
+            try {
+                accept(config.players[i], connections[i]);
+            } catch (const std::exception& e) {
+                crash(i, e.what());
+            }
+        }
+    }
+
+    GameEngine engine(GameEngine::createGame(config.properties, config.levelText, config.seed), config.seed);
+    const std::vector<Player>& players = engine.getGame().players;
+    std::vector<std::chrono::steady_clock::time_point> sentAt(connections.size());
+    auto connected = [this](int i) {
+        return connections[i].inputStream != nullptr && !connections[i].crashed;
+    };
+    while (!engine.isFinished()) {
+        const Game& game = engine.getGame();
+        // All messages go out before waiting for any reply, the clients think at the same time
+        for (size_t i = 0; i < connections.size(); ++i) {
+            if (!connected(i)) {
+                continue;
+            }
+            try {
+                ServerMessageGame(std::make_shared<PlayerView>(players[i].id, game))
+                    .writeTo(*connections[i].outputStream);
+                connections[i].outputStream->flush();
+                sentAt[i] = std::chrono::steady_clock::now();
+            } catch (const std::exception& e) {
+                crash(i, e.what());
+            }
+        }
+
+        std::unordered_map<int, int> unitPlayers;
+        for (const Unit& unit : game.units) {
+            unitPlayers[unit.id] = unit.playerId;
+        }
+        std::unordered_map<int, UnitAction> actions;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            if (!connected(i)) {
+                continue;
+            }
+            try {
+                std::shared_ptr<PlayerMessageGame::ActionMessage> actionMessage;
+                while (!actionMessage) {
+                    // The debug drawings before the actions are dropped
+                    actionMessage = std::dynamic_pointer_cast<PlayerMessageGame::ActionMessage>(
+                        PlayerMessageGame::readFrom(*connections[i].inputStream));
+                }
+                connections[i].responseTimes.push_back(std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - sentAt[i]).count());
+                for (const auto& [unitId, action] : actionMessage->action.inner) {
+                    auto unitPlayer = unitPlayers.find(unitId);
+                    if (unitPlayer != unitPlayers.end() && unitPlayer->second == players[i].id) {
+                        actions[unitId] = action;
+                    }
+                }
+            } catch (const std::exception& e) {
+                crash(i, e.what());
+            }
+        }
+        engine.tick(actions);
+    }
+
+    std::vector<bool> crashed;
+    for (size_t i = 0; i < connections.size(); ++i) {
+        if (connected(i)) {
+            try {
+                ServerMessageGame(nullptr).writeTo(*connections[i].outputStream);
+                connections[i].outputStream->flush();
+            } catch (const std::exception&) {
+                // The game is over anyway
+            }
+        }
+        crashed.push_back(connections[i].crashed);
+        disconnect(connections[i]);
+    }
+    return GameEngine::formatResults(engine.getGame().players, crashed, config.seed);
+}
+
+const std::vector<double>& GameServer::getResponseTimes(int playerIndex) const {
+    return connections[playerIndex].responseTimes;
+}
+
+void GameServer::listen(const PlayerConfig& player, Connection& connection) {
+    if (player.kind == PlayerConfig::SHARED_MEMORY) {
+        // The client attaches to the channel, there is nothing to accept
+        connection.channel = SharedMemoryChannel::create(player.path);
+        return;
+    }
+    if (player.kind == PlayerConfig::TCP) {
+        connection.listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (connection.listener == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        int yes = 1;
+        setsockopt(connection.listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(player.port);
+        if (inet_pton(AF_INET, player.host.c_str(), &address.sin_addr) != 1) {
+            throw std::runtime_error("Bad host " + player.host);
+        }
+        if (bind(connection.listener, (sockaddr *)&address, sizeof(address)) == -1) {
+            throw std::runtime_error("Failed to bind port " + std::to_string(player.port));
+        }
+    } else {
+        connection.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection.listener == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (player.path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + player.path);
+        }
+        std::strcpy(address.sun_path, player.path.c_str());
+        unlink(player.path.c_str());
+        if (bind(connection.listener, (sockaddr *)&address, sizeof(address)) == -1) {
+            throw std::runtime_error("Failed to bind " + player.path);
+        }
+    }
+    if (::listen(connection.listener, 1) == -1) {
+        throw std::runtime_error("Failed to listen");
+    }
+}
+
+void GameServer::accept(const PlayerConfig& player, Connection& connection) {
+    if (player.kind == PlayerConfig::SHARED_MEMORY) {
+        connection.inputStream = connection.channel->getInputStream();
+        connection.outputStream = connection.channel->getOutputStream();
+        // The token is the first thing the client sends, waiting for it is waiting for the client
+        connection.channel->setReadTimeout(player.acceptTimeout);
+        std::string token = connection.inputStream->readString();
+        connection.channel->setReadTimeout(player.timeout);
+        if (player.token && token != *player.token) {
+            throw std::runtime_error("Wrong token");
+        }
+        return;
+    }
+    if (player.acceptTimeout) {
+        pollfd request = {connection.listener, POLLIN, 0};
+        if (poll(&request, 1, int(*player.acceptTimeout * 1000)) <= 0) {
+            throw std::runtime_error("The client didn't connect in time");
+        }
+    }
+    SOCKET sock = ::accept(connection.listener, nullptr, nullptr);
+    if (sock == -1) {
+        throw std::runtime_error("Failed to accept the client");
+    }
+    close(connection.listener);
+    connection.listener = -1;
+    if (player.kind == PlayerConfig::TCP) {
+        int yes = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+    if (player.timeout) {
+        // A reply later than that fails the read and crashes the player
+        timeval timeout;
+        timeout.tv_sec = long(*player.timeout);
+        timeout.tv_usec = long((*player.timeout - timeout.tv_sec) * 1e6);
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    connection.socket = std::make_shared<TcpStream>(sock);
+    connection.inputStream = getInputStream(connection.socket);
+    connection.outputStream = getOutputStream(connection.socket);
+    std::string token = connection.inputStream->readString();
+    if (player.token && token != *player.token) {
+        throw std::runtime_error("Wrong token");
+    }
+}
+
+void GameServer::crash(int playerIndex, const std::string& reason) {
+    std::cerr << "Player " << playerIndex + 1 << " crashed: " << reason << "\n";
+    connections[playerIndex].crashed = true;
+    disconnect(connections[playerIndex]);
+}
+
+void GameServer::disconnect(Connection& connection) {
+    if (connection.listener != -1) {
+        close(connection.listener);
+        connection.listener = -1;
+    }
+    if (connection.socket) {
+        close(connection.socket->sock);
+        connection.socket = nullptr;
+    }
+    // The channel is closed and removed once the streams are released too
+    connection.channel = nullptr;
+    connection.inputStream = nullptr;
+    connection.outputStream = nullptr;
+}
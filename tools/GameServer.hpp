@@ -0,0 +1,85 @@
+#ifndef _TOOLS_GAMESERVER_HPP_
+#define _TOOLS_GAMESERVER_HPP_
+
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../model/Properties.hpp"
+#include "../SharedMemoryStream.hpp"
+#include "../Stream.hpp"
+#include "../TcpStream.hpp"
+
+// Player of the server config. Tcp, Unix and SharedMemory players are clients connecting to the server, Empty players
+// stand still.
+struct PlayerConfig {
+    enum Kind {
+        TCP,
+        UNIX,
+        SHARED_MEMORY,
+        EMPTY
+    };
+
+    Kind kind = EMPTY;
+    // Address and port listened on for a Tcp player
+    std::string host = "127.0.0.1";
+    int port = 0;
+    // Socket file of a Unix player, name of the shared memory object of a SharedMemory player
+    std::string path;
+    // The client must send it when set
+    std::optional<std::string> token;
+    // Seconds, no limit when not set
+    std::optional<double> acceptTimeout;
+    std::optional<double> timeout;
+};
+
+struct ServerConfig {
+    Properties properties;
+    std::string levelText;
+    unsigned seed = 0;
+    std::vector<PlayerConfig> players;
+
+    // The config.json format of the LocalRunner with the Custom options preset. Unix and SharedMemory players are
+    // an extension: {"Unix": {"path": ..., "accept_timeout": ..., "timeout": ..., "token": ...}} and
+    // {"SharedMemory": {"name": ..., ...}}. A null seed is random.
+    static ServerConfig fromJson(const std::string& text);
+};
+
+// Stand-in for the LocalRunner: plays one game of GameEngine with the clients of the config over the protocol of the
+// game. A client that disconnects, sends a broken message or runs out of time is crashed and its units stand still.
+class GameServer {
+public:
+    explicit GameServer(ServerConfig config);
+    ~GameServer();
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    // Accepts the clients, plays the game and returns the object of the LocalRunner's --save-results file
+    std::string run();
+
+    // Microseconds from sending the message of a tick to the player until its actions arrived
+    const std::vector<double>& getResponseTimes(int playerIndex) const;
+
+private:
+    struct Connection {
+        SOCKET listener = -1;
+        std::shared_ptr<TcpStream> socket;
+        std::shared_ptr<SharedMemoryChannel> channel;
+        std::shared_ptr<InputStream> inputStream;
+        std::shared_ptr<OutputStream> outputStream;
+        bool crashed = false;
+        std::vector<double> responseTimes;
+    };
+
+    void listen(const PlayerConfig& player, Connection& connection);
+    void accept(const PlayerConfig& player, Connection& connection);
+    void crash(int playerIndex, const std::string& reason);
+    void disconnect(Connection& connection);
+
+    ServerConfig config;
+    std::vector<Connection> connections;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "JsonValue.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+class JsonValue::Parser {
+public:
+    explicit Parser(const std::string& text) : text(text), position(0) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue();
+        skipSpaces();
+        if (position != text.size()) {
+            fail("unexpected data after the value");
+        }
+        return value;
+    }
+
+private:
+    JsonValue parseValue() {
+        skipSpaces();
+        if (position == text.size()) {
+            fail("unexpected end");
+        }
+        JsonValue value;
+        char c = text[position];
+        if (c == '{') {
+            value.type = OBJECT;
+            ++position;
+            if (!consume('}')) {
+                do {
+                    skipSpaces();
+                    std::string key = parseString();
+                    if (!consume(':')) {
+                        fail("expected ':'");
+                    }
+                    value.object.emplace_back(std::move(key), parseValue());
+                } while (consume(','));
+                if (!consume('}')) {
+                    fail("expected '}'");
+                }
+            }
+        } else if (c == '[') {
+            value.type = ARRAY;
+            ++position;
+            if (!consume(']')) {
+                do {
+                    value.array.push_back(parseValue());
+                } while (consume(','));
+                if (!consume(']')) {
+                    fail("expected ']'");
+                }
+            }
+        } else if (c == '"') {
+            value.type = STRING;
+            value.string = parseString();
+        } else if (text.compare(position, 4, "null") == 0) {
+            position += 4;
+        } else if (text.compare(position, 4, "true") == 0) {
+            value.type = BOOLEAN;
+            value.boolean = true;
+            position += 4;
+        } else if (text.compare(position, 5, "false") == 0) {
+            value.type = BOOLEAN;
+            position += 5;
+        } else {
+            const char* start = text.c_str() + position;
+            char* end = nullptr;
+            value.type = NUMBER;
+            value.number = std::strtod(start, &end);
+            if (end == start) {
+                fail("unexpected character");
+            }
+            position += end - start;
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (!consume('"')) {
+            fail("expected a string");
+        }
+        std::string result;
+        while (true) {
+            if (position == text.size()) {
+                fail("unterminated string");
+            }
+            char c = text[position++];
+            if (c == '"') {
+                return result;
+            }
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (position == text.size()) {
+                fail("unterminated string");
+            }
+            char escaped = text[position++];
+            switch (escaped) {
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u': appendCodePoint(result); break;
+                default: result += escaped; break;
+            }
+        }
+    }
+
+    // Characters outside of the basic plane aren't combined from surrogate pairs, paths and tokens don't need them
+    void appendCodePoint(std::string& result) {
+        if (position + 4 > text.size()) {
+            fail("bad \\u escape");
+        }
+        unsigned code = std::strtoul(text.substr(position, 4).c_str(), nullptr, 16);
+        position += 4;
+        if (code < 0x80) {
+            result += char(code);
+        } else if (code < 0x800) {
+            result += char(0xC0 | (code >> 6));
+            result += char(0x80 | (code & 0x3F));
+        } else {
+            result += char(0xE0 | (code >> 12));
+            result += char(0x80 | ((code >> 6) & 0x3F));
+            result += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    void skipSpaces() {
+        while (position < text.size() &&
+               (text[position] == ' ' || text[position] == '\n' || text[position] == '\r' || text[position] == '\t')) {
+            ++position;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpaces();
+        if (position < text.size() && text[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("Bad JSON at offset " + std::to_string(position) + ": " + message);
+    }
+
+    const std::string& text;
+    size_t position;
+};
+
+JsonValue JsonValue::parse(const std::string& text) {
+    return Parser(text).parseDocument();
+}
+
+JsonValue::Type JsonValue::getType() const {
+    return type;
+}
+
+bool JsonValue::isNull() const {
+    return type == NUL;
+}
+
+bool JsonValue::asBool() const {
+    expect(BOOLEAN);
+    return boolean;
+}
+
+double JsonValue::asDouble() const {
+    expect(NUMBER);
+    return number;
+}
+
+int JsonValue::asInt() const {
+    expect(NUMBER);
+    if (number != std::floor(number)) {
+        throw std::runtime_error("JSON number " + std::to_string(number) + " is not an integer");
+    }
+    return int(number);
+}
+
+const std::string& JsonValue::asString() const {
+    expect(STRING);
+    return string;
+}
+
+const std::vector<JsonValue>& JsonValue::asArray() const {
+    expect(ARRAY);
+    return array;
+}
+
+const std::vector<std::pair<std::string, JsonValue>>& JsonValue::asObject() const {
+    expect(OBJECT);
+    return object;
+}
+
+bool JsonValue::has(const std::string& key) const {
+    for (const auto& [name, value] : asObject()) {
+        if (name == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+    for (const auto& [name, value] : asObject()) {
+        if (name == key) {
+            return value;
+        }
+    }
+    throw std::runtime_error("JSON object has no member " + key);
+}
+
+void JsonValue::expect(Type expected) const {
+    static const char* NAMES[] = {"null", "boolean", "number", "string", "array", "object"};
+    if (type != expected) {
+        throw std::runtime_error(std::string("JSON value is ") + NAMES[type] + ", not " + NAMES[expected]);
+    }
+}
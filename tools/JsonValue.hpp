@@ -0,0 +1,51 @@
+#ifndef _TOOLS_JSONVALUE_HPP_
+#define _TOOLS_JSONVALUE_HPP_
+
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Parsed JSON document, enough for the config files of the LocalRunner. Accessing a value as another type or a
+// missing key throws std::runtime_error.
+class JsonValue {
+public:
+    enum Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    static JsonValue parse(const std::string& text);
+
+    Type getType() const;
+    bool isNull() const;
+
+    bool asBool() const;
+    double asDouble() const;
+    int asInt() const;
+    const std::string& asString() const;
+    const std::vector<JsonValue>& asArray() const;
+    // Members in the order of the document
+    const std::vector<std::pair<std::string, JsonValue>>& asObject() const;
+
+    bool has(const std::string& key) const;
+    const JsonValue& operator[](const std::string& key) const;
+
+private:
+    class Parser;
+
+    void expect(Type expected) const;
+
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+};
+
+#endif
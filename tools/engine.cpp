@@ -0,0 +1,194 @@
+// Plays seeded games between two instances of the strategy in-process on GameEngine, without the LocalRunner.
+// The result of every game is written in the format of the LocalRunner's --save-results file.
+#include "../Debug.hpp"
+#include "../GameEngine.hpp"
+#include "../MyStrategy.hpp"
+#include "../ThreadPool.hpp"
+#include "DecisionChecksum.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int games = 1;
+    int startSeed = 1;
+    int threads = std::max(1, int(std::thread::hardware_concurrency()));
+    std::string level = "Simple";
+    int teamSize = 0;
+    int maxTicks = 0;
+    int planningBudgetMs = PlannerConfig::UNLIMITED_PLANNING_BUDGET_MS;
+    std::string resultsPath;
+};
+
+struct GameResult {
+    unsigned seed = 0;
+    // In the order of the players of the game
+    std::vector<Player> players;
+    std::vector<bool> crashed = std::vector<bool>(2, false);
+    // The strategy configured by AICUP_* plays the second player in odd games
+    bool swapped = false;
+    uint64_t decisionChecksum = 0;
+};
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--games N] [--start-seed S] [--threads T] [--level Simple|<file>]"
+              << " [--team-size N] [--max-ticks N] [--planning-budget-ms N] [--save-results <file>]\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string name = argv[i];
+        if (i + 1 == argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (name == "--games") {
+            options.games = atoi(value.c_str());
+        } else if (name == "--start-seed") {
+            options.startSeed = atoi(value.c_str());
+        } else if (name == "--threads") {
+            options.threads = std::max(1, atoi(value.c_str()));
+        } else if (name == "--level") {
+            options.level = value;
+        } else if (name == "--team-size") {
+            options.teamSize = atoi(value.c_str());
+        } else if (name == "--max-ticks") {
+            options.maxTicks = atoi(value.c_str());
+        } else if (name == "--planning-budget-ms") {
+            options.planningBudgetMs = atoi(value.c_str());
+        } else if (name == "--save-results") {
+            options.resultsPath = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+GameResult playGame(const Properties& properties, const std::string& levelText, int seed, bool swapped,
+                    const std::array<PlannerConfig, 2>& configs) {
+    GameEngine engine(GameEngine::createGame(properties, levelText, seed), seed);
+    const std::vector<Player>& players = engine.getGame().players;
+    std::array<std::unique_ptr<MyStrategy>, 2> strategies;
+    std::array<std::unique_ptr<Debug>, 2> debugs;
+    GameResult result;
+    result.seed = seed;
+    result.swapped = swapped;
+    for (int i = 0; i < 2; ++i) {
+        strategies[i] = std::make_unique<MyStrategy>(1, configs[swapped ? 1 - i : i]);
+        debugs[i] = std::make_unique<Debug>(std::make_shared<NullOutputStream>());
+    }
+
+    DecisionChecksum checksum;
+    while (!engine.isFinished()) {
+        std::unordered_map<int, UnitAction> actions;
+        for (int i = 0; i < 2; ++i) {
+            if (result.crashed[i]) {
+                continue;
+            }
+            const int playerId = players[i].id;
+            try {
+                for (const auto& [unitId, action] : strategies[i]->getActions(PlayerView(playerId, engine.getGame()),
+                                                                              *debugs[i])) {
+                    for (const Unit& unit : engine.getGame().units) {
+                        if (unit.id == unitId && unit.playerId == playerId) {
+                            actions[unitId] = action;
+                        }
+                    }
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "seed " << seed << ": player " << playerId << " crashed: " << e.what() << "\n";
+                result.crashed[i] = true;
+            }
+            debugs[i]->writePending();
+        }
+        checksum.addTick(actions);
+        engine.tick(actions);
+    }
+    result.players = engine.getGame().players;
+    result.decisionChecksum = checksum.value();
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options) || options.games <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    Properties properties = GameEngine::defaultProperties();
+    if (options.teamSize > 0) {
+        properties.teamSize = options.teamSize;
+    }
+    if (options.maxTicks > 0) {
+        properties.maxTickCount = options.maxTicks;
+    }
+    std::string levelText;
+    try {
+        levelText = GameEngine::readLevel(options.level);
+        // Checked here rather than in every game on the pool
+        std::vector<Vec2Double> spawns;
+        GameEngine::parseLevel(levelText, spawns);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    // The second strategy reads the same options with the AICUP_OPPONENT_ prefix. The budget is the same for both,
+    // unlimited by default so that a seed always plays the same game, whatever the machine and the games beside it.
+    std::array<PlannerConfig, 2> configs = {
+        PlannerConfig::fromEnvironment(),
+        PlannerConfig::fromEnvironment("AICUP_OPPONENT_")
+    };
+    for (PlannerConfig& config : configs) {
+        config.planningBudgetMs = options.planningBudgetMs;
+    }
+
+    std::vector<GameResult> results(options.games);
+    ThreadPool games(std::min(options.threads, options.games));
+    games.parallelFor(options.games, [&](int i) {
+        results[i] = playGame(properties, levelText, options.startSeed + i, i % 2 == 1, configs);
+    });
+
+    std::ofstream resultsFile;
+    if (!options.resultsPath.empty()) {
+        resultsFile.open(options.resultsPath);
+        if (!resultsFile) {
+            std::cerr << "Failed to open " << options.resultsPath << "\n";
+            return 1;
+        }
+    }
+    int strategyWins = 0;
+    int opponentWins = 0;
+    int draws = 0;
+    for (const GameResult& result : results) {
+        std::fprintf(stderr, "seed %u: decision checksum %016llx\n", result.seed,
+                     (unsigned long long)result.decisionChecksum);
+        std::string json = GameEngine::formatResults(result.players, result.crashed, result.seed);
+        std::cout << json << "\n";
+        if (resultsFile.is_open()) {
+            resultsFile << json << "\n";
+        }
+        int strategyScore = result.players[result.swapped ? 1 : 0].score;
+        int opponentScore = result.players[result.swapped ? 0 : 1].score;
+        if (strategyScore > opponentScore) {
+            ++strategyWins;
+        } else if (strategyScore < opponentScore) {
+            ++opponentWins;
+        } else {
+            ++draws;
+        }
+    }
+    std::cerr << "p1_win: " << strategyWins << ", p2_win: " << opponentWins << ", draws: " << draws << "\n";
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Replays the server messages of a game record (see GameRecorder) through the strategy without a server and reports
+// how long the decisions took. Usage: aicup2019_replay <record file> [repeats] [first tick]
+#include "../Debug.hpp"
+#include "../GameRecorder.hpp"
+#include "../MessageReader.hpp"
+#include "../MyStrategy.hpp"
+#include "DecisionChecksum.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = std::min(sorted.size() - 1, size_t(fraction * sorted.size()));
+    return sorted[index];
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <record file> [repeats] [first tick]\n";
+        return 2;
+    }
+    std::string recordPath = argv[1];
+    int repeats = argc < 3 ? 1 : std::max(1, atoi(argv[2]));
+    int firstTick = argc < 4 ? 0 : atoi(argv[3]);
+    const char* threads = std::getenv("AICUP_THREADS");
+    int threadsCount = threads == nullptr ? 1 : atoi(threads);
+    PlannerConfig plannerConfig = PlannerConfig::fromEnvironment();
+    // The budget of the recorded game would make the decisions depend on the speed of the machine and the load
+    const char* budget = std::getenv("AICUP_REPLAY_PLANNING_BUDGET_MS");
+    plannerConfig.planningBudgetMs = budget == nullptr ? PlannerConfig::UNLIMITED_PLANNING_BUDGET_MS : atoi(budget);
+
+    std::vector<double> latencies;
+    std::vector<uint64_t> checksums;
+    auto wallStart = std::chrono::steady_clock::now();
+    std::clock_t cpuStart = std::clock();
+    for (int repeat = 0; repeat < repeats; ++repeat) {
+        // Every repeat starts from a new strategy, without a budget all of them make the same decisions
+        MyStrategy myStrategy(threadsCount, plannerConfig);
+        Debug debug(std::make_shared<NullOutputStream>());
+        auto recordStream = std::make_shared<RecordInputStream>(recordPath);
+        if (firstTick != 0 && !recordStream->seekTick(firstTick)) {
+            std::cerr << recordPath << " has no tick " << firstTick << "\n";
+            return 1;
+        }
+        MessageReader messageReader(recordStream);
+        PlayerView playerView;
+        DecisionChecksum checksum;
+        while (messageReader.readServerMessage(playerView)) {
+            auto start = std::chrono::steady_clock::now();
+            auto actions = myStrategy.getActions(playerView, debug);
+            auto finish = std::chrono::steady_clock::now();
+            latencies.push_back(std::chrono::duration<double, std::micro>(finish - start).count());
+            checksum.addTick(actions);
+            debug.writePending();
+        }
+        checksums.push_back(checksum.value());
+    }
+    std::clock_t cpuFinish = std::clock();
+    auto wallFinish = std::chrono::steady_clock::now();
+
+    if (latencies.empty()) {
+        std::cerr << recordPath << " has no server messages\n";
+        return 1;
+    }
+    double totalLatency = 0;
+    for (double latency : latencies) {
+        totalLatency += latency;
+    }
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    std::printf("ticks: %zu\n", latencies.size());
+    std::printf("tick latency us: p50 %.0f, p95 %.0f, p99 %.0f, max %.0f, mean %.0f\n",
+                percentile(sorted, 0.5), percentile(sorted, 0.95), percentile(sorted, 0.99), sorted.back(),
+                totalLatency / latencies.size());
+    std::printf("wall time: %.1f ms\n", std::chrono::duration<double, std::milli>(wallFinish - wallStart).count());
+    std::printf("cpu time: %.1f ms\n", 1000.0 * (cpuFinish - cpuStart) / CLOCKS_PER_SEC);
+    bool deterministic = std::all_of(checksums.begin(), checksums.end(), [&checksums](uint64_t checksum) {
+        return checksum == checksums[0];
+    });
+    for (size_t repeat = 0; repeat < (deterministic ? 1 : checksums.size()); ++repeat) {
+        std::printf("decision checksum: %016llx\n", (unsigned long long)checksums[repeat]);
+    }
+
+    const char* perf = std::getenv("AICUP_REPLAY_PERF");
+    if (perf != nullptr && atoi(perf) != 0) {
+        MyStrategy::mergePerf();
+        for (const auto&[key, value] : MyStrategy::PERF) {
+            std::printf("%s: %d ms\n", key.c_str(), value);
+        }
+        for (const auto&[key, value] : MyStrategy::COUNTERS) {
+            std::printf("%s: %d\n", key.c_str(), value);
+        }
+    }
+    if (!deterministic) {
+        std::cerr << "The repeats made different decisions\n";
+        return 1;
+    }
+    return 0;
+}
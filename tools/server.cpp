@@ -0,0 +1,99 @@
+// Local stand-in for the LocalRunner: serves one game to the strategy clients over TCP or Unix sockets.
+// Usage: aicup2019_server [--config config.json] [--seed S] [--save-results <file>]
+#include "GameServer.hpp"
+#include "../GameEngine.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Two Tcp players on the ports of the local runner, the properties and the level of config.json
+ServerConfig defaultConfig() {
+    ServerConfig config;
+    config.properties = GameEngine::defaultProperties();
+    config.levelText = GameEngine::simpleLevel();
+    config.seed = 1;
+    for (int port : {31001, 31002}) {
+        PlayerConfig player;
+        player.kind = PlayerConfig::TCP;
+        player.port = port;
+        config.players.push_back(player);
+    }
+    return config;
+}
+
+void printResponseTimes(int playerIndex, std::vector<double> times) {
+    if (times.empty()) {
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double time : times) {
+        total += time;
+    }
+    auto percentile = [&times](double fraction) {
+        return times[std::min(times.size() - 1, size_t(fraction * times.size()))];
+    };
+    std::cerr << "player " << playerIndex + 1 << " response us: p50 " << percentile(0.5) << ", p95 "
+              << percentile(0.95) << ", p99 " << percentile(0.99) << ", max " << times.back() << ", mean "
+              << total / times.size() << "\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string configPath;
+    std::string resultsPath;
+    std::string seed;
+    bool validArguments = argc % 2 == 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        if (name == "--config") {
+            configPath = argv[i + 1];
+        } else if (name == "--seed") {
+            seed = argv[i + 1];
+        } else if (name == "--save-results") {
+            resultsPath = argv[i + 1];
+        } else {
+            validArguments = false;
+        }
+    }
+    if (!validArguments) {
+        std::cerr << "Usage: " << argv[0] << " [--config config.json] [--seed S] [--save-results <file>]\n";
+        return 2;
+    }
+    // A client going away mid-send crashes it instead of the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    ServerConfig config = defaultConfig();
+    if (!configPath.empty()) {
+        std::ifstream file(configPath);
+        if (!file) {
+            std::cerr << "Failed to open " << configPath << "\n";
+            return 1;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        config = ServerConfig::fromJson(text.str());
+    }
+    if (!seed.empty()) {
+        config.seed = std::strtoul(seed.c_str(), nullptr, 10);
+    }
+
+    GameServer server(config);
+    std::string results = server.run();
+    std::cout << results << "\n";
+    if (!resultsPath.empty()) {
+        std::ofstream(resultsPath) << results << "\n";
+    }
+    for (size_t i = 0; i < config.players.size(); ++i) {
+        printResponseTimes(i, server.getResponseTimes(i));
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Round trip of a tick over every transport the bot can connect with: the server thread sends a real message of
+// the game, the client thread decodes it and replies with the actions of its units.
+// Usage: aicup2019_transport_bench [ticks]
+#include "../GameEngine.hpp"
+#include "../MessageReader.hpp"
+#include "../SharedMemoryStream.hpp"
+#include "../TcpStream.hpp"
+#include "../Transport.hpp"
+#include "../model/PlayerMessageGame.hpp"
+#include "../model/ServerMessageGame.hpp"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/un.h>
+
+namespace {
+
+// Listening socket of the server side, bound before the client thread starts
+SOCKET listenTcp(int& port) {
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    socklen_t length = sizeof(address);
+    if (listener == -1 || bind(listener, (sockaddr *)&address, sizeof(address)) == -1
+        || ::listen(listener, 1) == -1 || getsockname(listener, (sockaddr *)&address, &length) == -1) {
+        throw std::runtime_error("Failed to listen on a TCP port");
+    }
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+SOCKET listenUnix(const std::string& path) {
+    SOCKET listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    unlink(path.c_str());
+    if (listener == -1 || bind(listener, (sockaddr *)&address, sizeof(address)) == -1 || ::listen(listener, 1) == -1) {
+        throw std::runtime_error("Failed to listen on " + path);
+    }
+    return listener;
+}
+
+std::shared_ptr<TcpStream> acceptSocket(SOCKET listener, bool tcp) {
+    SOCKET sock = ::accept(listener, nullptr, nullptr);
+    close(listener);
+    if (sock == -1) {
+        throw std::runtime_error("Failed to accept the client");
+    }
+    if (tcp) {
+        int yes = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+    return std::make_shared<TcpStream>(sock);
+}
+
+// Decodes the messages like the bot does and replies with an action for every unit of its player
+void runClient(const std::string& host, int port) {
+    Transport transport = connectTransport(host, port);
+    transport.outputStream->write(std::string("0000000000000000"));
+    transport.outputStream->flush();
+    MessageReader messageReader(transport.inputStream);
+    PlayerView playerView;
+    while (messageReader.readServerMessage(playerView)) {
+        std::unordered_map<int, UnitAction> actions;
+        for (const Unit& unit : playerView.game.units) {
+            if (unit.playerId == playerView.myId) {
+                actions[unit.id] = UnitAction(10, true, false, Vec2Double(1, 0), true, false, false, false);
+            }
+        }
+        PlayerMessageGame::ActionMessage(Versioned(actions)).writeTo(*transport.outputStream);
+        transport.outputStream->flush();
+    }
+}
+
+// Plays the server of the benchmark on the streams and returns the round trips in microseconds
+std::vector<double> runServer(InputStream& input, OutputStream& output, const Game& game, int ticks) {
+    input.readString();
+    ServerMessageGame message(std::make_shared<PlayerView>(game.players[0].id, game));
+    std::vector<double> times;
+    for (int tick = 0; tick < ticks; ++tick) {
+        auto start = std::chrono::steady_clock::now();
+        message.writeTo(output);
+        output.flush();
+        PlayerMessageGame::readFrom(input);
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    ServerMessageGame(nullptr).writeTo(output);
+    output.flush();
+    return times;
+}
+
+void printTimes(const std::string& transport, std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double time : times) {
+        total += time;
+    }
+    auto percentile = [&times](double fraction) {
+        return times[std::min(times.size() - 1, size_t(fraction * times.size()))];
+    };
+    std::cout << transport << " round trip us: p50 " << percentile(0.5) << ", p95 " << percentile(0.95) << ", p99 "
+              << percentile(0.99) << ", max " << times.back() << ", mean " << total / times.size() << "\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int ticks = argc < 2 ? 3600 : atoi(argv[1]);
+    if (argc > 2 || ticks <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [ticks]\n";
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    Game game = GameEngine::createGame(GameEngine::defaultProperties(), GameEngine::simpleLevel(), 1);
+    std::string suffix = std::to_string(getpid());
+
+    {
+        int port = 0;
+        SOCKET listener = listenTcp(port);
+        std::thread client(runClient, "127.0.0.1", port);
+        auto socket = acceptSocket(listener, true);
+        printTimes("tcp", runServer(*getInputStream(socket), *getOutputStream(socket), game, ticks));
+        client.join();
+        close(socket->sock);
+    }
+    {
+        std::string path = "/tmp/aicup2019_bench_" + suffix + ".sock";
+        SOCKET listener = listenUnix(path);
+        std::thread client(runClient, "unix:" + path, 0);
+        auto socket = acceptSocket(listener, false);
+        printTimes("unix", runServer(*getInputStream(socket), *getOutputStream(socket), game, ticks));
+        client.join();
+        close(socket->sock);
+        unlink(path.c_str());
+    }
+#ifdef __linux__
+    {
+        std::string name = "/aicup2019_bench_" + suffix;
+        auto channel = SharedMemoryChannel::create(name);
+        std::thread client(runClient, "shm:" + name, 0);
+        printTimes("shm", runServer(*channel->getInputStream(), *channel->getOutputStream(), game, ticks));
+        client.join();
+    }
+#endif
+    return 0;
+}